@@ -361,11 +361,43 @@ bool AuctionHouseMgr::RemoveAItem(uint32 id)
     return true;
 }
 
+void AuctionHouseMgr::ScheduleAuctionExpiry(AuctionHouseObject* auctionHouse, AuctionEntry const* auction)
+{
+    mExpiryQueue.push(AuctionExpiry(auction->expire_time, auction->Id, auctionHouse));
+}
+
 void AuctionHouseMgr::Update()
 {
-    mHordeAuctions.Update();
-    mAllianceAuctions.Update();
-    mNeutralAuctions.Update();
+    ///- Handle expired auctions, including the ones ending before the next update
+    time_t expireBefore = sWorld->GetGameTime() + MINUTE;
+    if (mExpiryQueue.empty() || mExpiryQueue.top().ExpireTime > expireBefore)
+        return;
+
+    SQLTransaction trans = CharacterDatabase.BeginTransaction();
+    uint32 pending = 0;
+
+    while (!mExpiryQueue.empty() && mExpiryQueue.top().ExpireTime <= expireBefore)
+    {
+        AuctionExpiry expiry = mExpiryQueue.top();
+        mExpiryQueue.pop();
+
+        // bought out or cancelled in the meantime
+        AuctionEntry* auction = expiry.AuctionHouse->GetAuction(expiry.AuctionId);
+        if (!auction || auction->expire_time != expiry.ExpireTime)
+            continue;
+
+        expiry.AuctionHouse->ExpireAuction(auction, trans);
+
+        if (++pending >= AUCTION_EXPIRE_BATCH_SIZE)
+        {
+            CharacterDatabase.CommitTransaction(trans);
+            trans = CharacterDatabase.BeginTransaction();
+            pending = 0;
+        }
+    }
+
+    if (pending)
+        CharacterDatabase.CommitTransaction(trans);
 }
 
 AuctionHouseEntry const* AuctionHouseMgr::GetAuctionHouseEntry(uint32 factionTemplateId)
@@ -413,12 +445,19 @@ void AuctionHouseObject::AddAuction(AuctionEntry* auction)
     ASSERT(auction);
 
     AuctionsMap[auction->Id] = auction;
+    sAuctionMgr->ScheduleAuctionExpiry(this, auction);
+
+    // auctions without their item are never listed by a search
+    if (Item* item = sAuctionMgr->GetAItem(auction->itemGUIDLow))
+        SearchIndex.Add(auction, item);
+
     sScriptMgr->OnAuctionAdd(this, auction);
 }
 
 bool AuctionHouseObject::RemoveAuction(AuctionEntry* auction, uint32 /*itemEntry*/)
 {
     bool wasInMap = AuctionsMap.erase(auction->Id) ? true : false;
+    SearchIndex.Remove(auction);
 
     sScriptMgr->OnAuctionRemove(this, auction);
 
@@ -429,59 +468,32 @@ bool AuctionHouseObject::RemoveAuction(AuctionEntry* auction, uint32 /*itemEntry
     return wasInMap;
 }
 
-void AuctionHouseObject::Update()
+void AuctionHouseObject::ExpireAuction(AuctionEntry* auction, SQLTransaction& trans)
 {
-    time_t curTime = sWorld->GetGameTime();
-    ///- Handle expired auctions
-
-    // If storage is empty, no need to update. next == NULL in this case.
-    if (AuctionsMap.empty())
-        return;
-
-    PreparedStatement* stmt = CharacterDatabase.GetPreparedStatement(CHAR_SEL_AUCTION_BY_TIME);
-    stmt->setUInt32(0, (uint32)curTime+60);
-    PreparedQueryResult result = CharacterDatabase.Query(stmt);
-
-    if (!result)
-        return;
-
-    do
+    ///- Either cancel the auction if there was no bidder
+    if (auction->bidder == 0)
     {
-        // from auctionhousehandler.cpp, creates auction pointer & player pointer
-        AuctionEntry* auction = GetAuction(result->Fetch()->GetUInt32());
-
-        if (!auction)
-            continue;
-
-        SQLTransaction trans = CharacterDatabase.BeginTransaction();
-
-        ///- Either cancel the auction if there was no bidder
-        if (auction->bidder == 0)
-        {
-            sAuctionMgr->SendAuctionExpiredMail(auction, trans);
-            sScriptMgr->OnAuctionExpire(this, auction);
-        }
-        ///- Or perform the transaction
-        else
-        {
-            //we should send an "item sold" message if the seller is online
-            //we send the item to the winner
-            //we send the money to the seller
-            sAuctionMgr->SendAuctionSuccessfulMail(auction, trans);
-            sAuctionMgr->SendAuctionWonMail(auction, trans);
-            sScriptMgr->OnAuctionSuccessful(this, auction);
-        }
+        sAuctionMgr->SendAuctionExpiredMail(auction, trans);
+        sScriptMgr->OnAuctionExpire(this, auction);
+    }
+    ///- Or perform the transaction
+    else
+    {
+        //we should send an "item sold" message if the seller is online
+        //we send the item to the winner
+        //we send the money to the seller
+        sAuctionMgr->SendAuctionSuccessfulMail(auction, trans);
+        sAuctionMgr->SendAuctionWonMail(auction, trans);
+        sScriptMgr->OnAuctionSuccessful(this, auction);
+    }
 
-        uint32 itemEntry = auction->itemEntry;
+    uint32 itemEntry = auction->itemEntry;
 
-        ///- In any case clear the auction
-        auction->DeleteFromDB(trans);
-        CharacterDatabase.CommitTransaction(trans);
+    ///- In any case clear the auction
+    auction->DeleteFromDB(trans);
 
-        sAuctionMgr->RemoveAItem(auction->itemGUIDLow);
-        RemoveAuction(auction, itemEntry);
-    }
-    while (result->NextRow());
+    sAuctionMgr->RemoveAItem(auction->itemGUIDLow);
+    RemoveAuction(auction, itemEntry);
 }
 
 void AuctionHouseObject::BuildListBidderItems(WorldPacket& data, Player* player, uint32& count, uint32& totalcount)
@@ -522,84 +534,58 @@ void AuctionHouseObject::BuildListAuctionItems(WorldPacket& data, Player* player
     int loc_idx = player->GetSession()->GetSessionDbLocaleIndex();
     int locdbc_idx = player->GetSession()->GetSessionDbcLocale();
 
-    for (AuctionEntryMap::const_iterator itr = AuctionsMap.begin(); itr != AuctionsMap.end(); ++itr)
+    bool exact;
+    AuctionSearchIndex::EntrySet const& candidates = SearchIndex.GetCandidates(itemClass, itemSubClass, inventoryType, quality, exact);
+
+    // the posting list is the result itself, only the requested page has to be walked
+    if (exact && wsearchedname.empty() && levelmin == 0x00 && usable == 0x00)
     {
-        AuctionEntry* Aentry = itr->second;
-        Item* item = sAuctionMgr->GetAItem(Aentry->itemGUIDLow);
-        if (!item)
-            continue;
+        totalcount = uint32(candidates.size());
+        AuctionSearchIndex::EntrySet::const_iterator itr = candidates.begin();
+        for (uint32 skipped = 0; itr != candidates.end() && skipped < listfrom; ++itr)
+            ++skipped;
 
-        ItemTemplate const* proto = item->GetTemplate();
+        for (; itr != candidates.end() && count < 50; ++itr)
+            if ((*itr)->Auction->BuildAuctionInfo(data))
+                ++count;
+        return;
+    }
 
-        if (itemClass != 0xffffffff && proto->Class != itemClass)
-            continue;
+    for (AuctionSearchIndex::EntrySet::const_iterator itr = candidates.begin(); itr != candidates.end(); ++itr)
+    {
+        AuctionSearchEntry const* entry = *itr;
 
-        if (itemSubClass != 0xffffffff && proto->SubClass != itemSubClass)
+        if (itemClass != 0xffffffff && entry->Class != itemClass)
             continue;
 
-        if (inventoryType != 0xffffffff && proto->InventoryType != inventoryType)
+        if (itemSubClass != 0xffffffff && entry->SubClass != itemSubClass)
             continue;
 
-        if (quality != 0xffffffff && proto->Quality != quality)
+        if (inventoryType != 0xffffffff && entry->InventoryType != inventoryType)
             continue;
 
-        if (levelmin != 0x00 && (proto->RequiredLevel < levelmin || (levelmax != 0x00 && proto->RequiredLevel > levelmax)))
+        if (quality != 0xffffffff && entry->Quality != quality)
             continue;
 
-        if (usable != 0x00 && player->CanUseItem(item) != EQUIP_ERR_OK)
+        if (!entry->MatchesLevel(levelmin, levelmax))
             continue;
 
-        // Allow search by suffix (ie: of the Monkey) or partial name (ie: Monkey)
-        // No need to do any of this if no search term was entered
-        if (!wsearchedname.empty())
+        if (usable != 0x00)
         {
-            std::string name = proto->Name1;
-            if (name.empty())
-                continue;
-
-            // local name
-            if (loc_idx >= 0)
-                if (ItemLocale const* il = sObjectMgr->GetItemLocale(proto->ItemId))
-                    ObjectMgr::GetLocaleString(il->Name, loc_idx, name);
-
-            // DO NOT use GetItemEnchantMod(proto->RandomProperty) as it may return a result
-            //  that matches the search but it may not equal item->GetItemRandomPropertyId()
-            //  used in BuildAuctionInfo() which then causes wrong items to be listed
-            int32 propRefID = item->GetItemRandomPropertyId();
-
-            if (propRefID)
-            {
-                // Append the suffix to the name (ie: of the Monkey) if one exists
-                // These are found in ItemRandomProperties.dbc, not ItemRandomSuffix.dbc
-                //  even though the DBC names seem misleading
-                const ItemRandomPropertiesEntry* itemRandProp = sItemRandomPropertiesStore.LookupEntry(propRefID);
-
-                if (itemRandProp)
-                {
-                    char* const* temp = itemRandProp->nameSuffix;
-
-                    // dbc local name
-                    if (temp)
-                    {
-                        // Append the suffix (ie: of the Monkey) to the name using localization
-                        // or default enUS if localization is invalid
-                        name += ' ';
-                        name += temp[locdbc_idx >= 0 ? locdbc_idx : LOCALE_enUS];
-                    }
-                }
-            }
-
-            // Perform the search (with or without suffix)
-            if (!Utf8FitTo(name, wsearchedname))
+            Item* item = sAuctionMgr->GetAItem(entry->Auction->itemGUIDLow);
+            if (!item || player->CanUseItem(item) != EQUIP_ERR_OK)
                 continue;
         }
 
+        // Allow search by suffix (ie: of the Monkey) or partial name (ie: Monkey)
+        // No need to do any of this if no search term was entered
+        if (!wsearchedname.empty() && !entry->MatchesName(uint8(loc_idx), uint8(locdbc_idx >= 0 ? locdbc_idx : LOCALE_enUS), wsearchedname))
+            continue;
+
         // Add the item if no search term or if entered search term was found
         if (count < 50 && totalcount >= listfrom)
-        {
-            ++count;
-            Aentry->BuildAuctionInfo(data);
-        }
+            if (entry->Auction->BuildAuctionInfo(data))
+                ++count;
         ++totalcount;
     }
 }
@@ -21,6 +21,9 @@
 
 #include <ace/Singleton.h>
 
+#include <queue>
+
+#include "AuctionSearchIndex.h"
 #include "Common.h"
 #include "DatabaseEnv.h"
 #include "DBCStructure.h"
@@ -31,6 +34,8 @@ class WorldPacket;
 
 #define MIN_AUCTION_TIME (12*HOUR)
 #define MAX_AUCTION_ITEMS 160
+// expired auctions settled per character database transaction
+#define AUCTION_EXPIRE_BATCH_SIZE 100
 
 enum AuctionError
 {
@@ -122,7 +127,7 @@ class AuctionHouseObject
 
     bool RemoveAuction(AuctionEntry* auction, uint32 itemEntry);
 
-    void Update();
+    void ExpireAuction(AuctionEntry* auction, SQLTransaction& trans);
 
     void BuildListBidderItems(WorldPacket& data, Player* player, uint32& count, uint32& totalcount);
     void BuildListOwnerItems(WorldPacket& data, Player* player, uint32& count, uint32& totalcount);
@@ -133,6 +138,7 @@ class AuctionHouseObject
 
   private:
     AuctionEntryMap AuctionsMap;
+    AuctionSearchIndex SearchIndex;                         // browse filters, see BuildListAuctionItems
 };
 
 class AuctionHouseMgr
@@ -182,15 +188,33 @@ class AuctionHouseMgr
         void AddAItem(Item* it);
         bool RemoveAItem(uint32 id);
 
+        void ScheduleAuctionExpiry(AuctionHouseObject* auctionHouse, AuctionEntry const* auction);
+
         void Update();
 
     private:
 
+        // expire_time never changes once an auction is listed, so entries are only dropped lazily
+        // when the auction turns out to be bought out or cancelled by the time it comes up
+        struct AuctionExpiry
+        {
+            AuctionExpiry(time_t expireTime, uint32 auctionId, AuctionHouseObject* auctionHouse) :
+                ExpireTime(expireTime), AuctionId(auctionId), AuctionHouse(auctionHouse) { }
+
+            // std::priority_queue keeps the greatest element on top, the earliest expiry has to be there
+            bool operator<(AuctionExpiry const& right) const { return ExpireTime > right.ExpireTime; }
+
+            time_t ExpireTime;
+            uint32 AuctionId;
+            AuctionHouseObject* AuctionHouse;
+        };
+
         AuctionHouseObject mHordeAuctions;
         AuctionHouseObject mAllianceAuctions;
         AuctionHouseObject mNeutralAuctions;
 
         ItemMap mAitems;
+        std::priority_queue<AuctionExpiry> mExpiryQueue;    // auctions of all houses by expire_time
 };
 
 #define sAuctionMgr ACE_Singleton<AuctionHouseMgr, ACE_Null_Mutex>::instance()
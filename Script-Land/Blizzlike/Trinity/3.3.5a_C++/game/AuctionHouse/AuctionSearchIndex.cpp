@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2008-2013 TrinityCore <http://www.trinitycore.org/>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AuctionSearchIndex.h"
+#include "AuctionHouseMgr.h"
+#include "DBCStores.h"
+#include "Item.h"
+#include "ObjectMgr.h"
+#include "Util.h"
+
+bool AuctionSearchEntry::MatchesName(uint8 locale, uint8 dbcLocale, std::wstring const& searchedname) const
+{
+    NameCache::const_iterator itr = _names.begin();
+    for (; itr != _names.end(); ++itr)
+        if (itr->first == locale)
+            break;
+
+    if (itr == _names.end())
+    {
+        std::wstring wname;
+
+        ItemTemplate const* proto = sObjectMgr->GetItemTemplate(ItemEntry);
+        std::string name = proto ? proto->Name1 : "";
+        if (!name.empty())
+        {
+            // local name
+            if (ItemLocale const* il = sObjectMgr->GetItemLocale(ItemEntry))
+                ObjectMgr::GetLocaleString(il->Name, locale, name);
+
+            // DO NOT use GetItemEnchantMod(proto->RandomProperty) as it may return a result
+            //  that matches the search but it may not equal item->GetItemRandomPropertyId()
+            //  used in BuildAuctionInfo() which then causes wrong items to be listed
+            if (RandomPropertyId)
+            {
+                // Append the suffix to the name (ie: of the Monkey) if one exists
+                // These are found in ItemRandomProperties.dbc, not ItemRandomSuffix.dbc
+                //  even though the DBC names seem misleading
+                if (ItemRandomPropertiesEntry const* itemRandProp = sItemRandomPropertiesStore.LookupEntry(RandomPropertyId))
+                {
+                    if (char* const* temp = itemRandProp->nameSuffix)
+                    {
+                        name += ' ';
+                        name += temp[dbcLocale];
+                    }
+                }
+            }
+
+            // names that can't be converted stay empty and never match, as in Utf8FitTo
+            if (Utf8toWStr(name, wname))
+                wstrToLower(wname);
+            else
+                wname.clear();
+        }
+
+        _names.push_back(std::make_pair(locale, wname));
+        itr = _names.end() - 1;
+    }
+
+    return !itr->second.empty() && itr->second.find(searchedname) != std::wstring::npos;
+}
+
+bool AuctionSearchIndex::IdLess::operator()(AuctionSearchEntry const* left, AuctionSearchEntry const* right) const
+{
+    return left->Auction->Id < right->Auction->Id;
+}
+
+AuctionSearchIndex::~AuctionSearchIndex()
+{
+    for (EntryMap::const_iterator itr = _entries.begin(); itr != _entries.end(); ++itr)
+        delete itr->second;
+}
+
+void AuctionSearchIndex::Add(AuctionEntry* auction, Item const* item)
+{
+    // the auction map overwrites an entry listed again under the same id, so do we
+    Remove(auction);
+
+    ItemTemplate const* proto = item->GetTemplate();
+
+    AuctionSearchEntry* entry = new AuctionSearchEntry();
+    entry->Auction = auction;
+    entry->ItemEntry = proto->ItemId;
+    entry->RandomPropertyId = item->GetItemRandomPropertyId();
+    entry->Class = proto->Class;
+    entry->SubClass = proto->SubClass;
+    entry->InventoryType = proto->InventoryType;
+    entry->Quality = proto->Quality;
+    entry->RequiredLevel = proto->RequiredLevel;
+
+    _entries[auction->Id] = entry;
+    _all.insert(entry);
+    Insert(_byClass, entry->Class, entry);
+    Insert(_bySubClass, SubClassKey(entry->Class, entry->SubClass), entry);
+    Insert(_byInventoryType, entry->InventoryType, entry);
+    Insert(_byQuality, entry->Quality, entry);
+}
+
+void AuctionSearchIndex::Remove(AuctionEntry const* auction)
+{
+    EntryMap::iterator itr = _entries.find(auction->Id);
+    if (itr == _entries.end())
+        return;
+
+    AuctionSearchEntry* entry = itr->second;
+    _entries.erase(itr);
+
+    _all.erase(entry);
+    Erase(_byClass, entry->Class, entry);
+    Erase(_bySubClass, SubClassKey(entry->Class, entry->SubClass), entry);
+    Erase(_byInventoryType, entry->InventoryType, entry);
+    Erase(_byQuality, entry->Quality, entry);
+
+    delete entry;
+}
+
+AuctionSearchIndex::EntrySet const& AuctionSearchIndex::GetCandidates(uint32 itemClass, uint32 itemSubClass, uint32 inventoryType, uint32 quality, bool& exact) const
+{
+    static EntrySet const empty;
+
+    EntrySet const* best = &_all;
+    uint32 covered = 0;                                     // filters implied by best
+    uint32 given = 0;
+
+    if (itemClass != AUCTION_SEARCH_ANY)
+    {
+        ++given;
+        if (itemSubClass != AUCTION_SEARCH_ANY)
+        {
+            ++given;
+            best = Find(_bySubClass, SubClassKey(itemClass, itemSubClass));
+            covered = 2;
+        }
+        else
+        {
+            best = Find(_byClass, itemClass);
+            covered = 1;
+        }
+    }
+    else if (itemSubClass != AUCTION_SEARCH_ANY)
+        ++given;                                            // subclass alone is checked per entry
+
+    if (inventoryType != AUCTION_SEARCH_ANY)
+    {
+        ++given;
+        EntrySet const* list = Find(_byInventoryType, inventoryType);
+        if (!list || (best && list->size() < best->size()))
+        {
+            best = list;
+            covered = 1;
+        }
+    }
+
+    if (quality != AUCTION_SEARCH_ANY)
+    {
+        ++given;
+        EntrySet const* list = Find(_byQuality, quality);
+        if (!list || (best && list->size() < best->size()))
+        {
+            best = list;
+            covered = 1;
+        }
+    }
+
+    // some filter value has no auction at all
+    if (!best)
+    {
+        exact = true;
+        return empty;
+    }
+
+    exact = covered == given;
+    return *best;
+}
+
+void AuctionSearchIndex::Erase(PostingMap& postings, uint32 key, AuctionSearchEntry const* entry)
+{
+    PostingMap::iterator itr = postings.find(key);
+    if (itr == postings.end())
+        return;
+
+    itr->second.erase(entry);
+    if (itr->second.empty())
+        postings.erase(itr);
+}
+
+AuctionSearchIndex::EntrySet const* AuctionSearchIndex::Find(PostingMap const& postings, uint32 key)
+{
+    PostingMap::const_iterator itr = postings.find(key);
+    return itr != postings.end() ? &itr->second : NULL;
+}
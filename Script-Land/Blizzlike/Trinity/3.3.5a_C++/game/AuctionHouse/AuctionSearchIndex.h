@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2008-2013 TrinityCore <http://www.trinitycore.org/>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _AUCTION_SEARCH_INDEX_H
+#define _AUCTION_SEARCH_INDEX_H
+
+#include "Define.h"
+#include "UnorderedMap.h"
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct AuctionEntry;
+class Item;
+
+// browse filter value meaning "any"
+#define AUCTION_SEARCH_ANY 0xffffffff
+
+/// What the browse filters look at, copied out of the item when the auction is listed
+struct AuctionSearchEntry
+{
+    AuctionEntry* Auction;
+    uint32 ItemEntry;
+    int32 RandomPropertyId;
+    uint32 Class;
+    uint32 SubClass;
+    uint32 InventoryType;
+    uint32 Quality;
+    uint32 RequiredLevel;
+
+    bool MatchesLevel(uint8 levelmin, uint8 levelmax) const
+    {
+        return levelmin == 0x00 || (RequiredLevel >= levelmin && (levelmax == 0x00 || RequiredLevel <= levelmax));
+    }
+
+    /// Localized name with random suffix contains the (lower case) search term
+    bool MatchesName(uint8 locale, uint8 dbcLocale, std::wstring const& searchedname) const;
+
+    private:
+        typedef std::vector<std::pair<uint8, std::wstring> > NameCache;
+
+        // lower case names per session db locale (the dbc locale follows from it), built on the first search in that locale
+        mutable NameCache _names;
+};
+
+/**
+ * Browse index of one auction house.
+ *
+ * Auctions are kept in posting lists by item class, class and subclass,
+ * inventory type and quality, each ordered by auction id so results page the
+ * same way the plain auction map did. A search walks the shortest list that
+ * applies and checks the remaining filters against the copied item data, so
+ * neither the item nor its template has to be touched for auctions that do
+ * not match.
+ */
+class AuctionSearchIndex
+{
+    public:
+        struct IdLess
+        {
+            bool operator()(AuctionSearchEntry const* left, AuctionSearchEntry const* right) const;
+        };
+
+        typedef std::set<AuctionSearchEntry const*, IdLess> EntrySet;
+
+        AuctionSearchIndex() { }
+        ~AuctionSearchIndex();
+
+        void Add(AuctionEntry* auction, Item const* item);
+        void Remove(AuctionEntry const* auction);
+
+        /**
+         * Shortest posting list holding every auction that can pass the equality filters.
+         * exact is set when all given equality filters are implied by the list itself.
+         */
+        EntrySet const& GetCandidates(uint32 itemClass, uint32 itemSubClass, uint32 inventoryType, uint32 quality, bool& exact) const;
+
+    private:
+        AuctionSearchIndex(AuctionSearchIndex const&);
+        AuctionSearchIndex& operator=(AuctionSearchIndex const&);
+
+        typedef UNORDERED_MAP<uint32, EntrySet> PostingMap;
+        typedef UNORDERED_MAP<uint32, AuctionSearchEntry*> EntryMap;
+
+        static uint32 SubClassKey(uint32 itemClass, uint32 itemSubClass) { return (itemClass << 16) | itemSubClass; }
+
+        static void Insert(PostingMap& postings, uint32 key, AuctionSearchEntry const* entry) { postings[key].insert(entry); }
+        static void Erase(PostingMap& postings, uint32 key, AuctionSearchEntry const* entry);
+        static EntrySet const* Find(PostingMap const& postings, uint32 key);
+
+        EntryMap _entries;                                  // auction id -> entry
+        EntrySet _all;
+        PostingMap _byClass;
+        PostingMap _bySubClass;                             // SubClassKey(class, subclass)
+        PostingMap _byInventoryType;
+        PostingMap _byQuality;
+};
+
+#endif
@@ -27,6 +27,8 @@
 #include "ObjectMgr.h"
 #include "Player.h"
 
+#include <ace/OS_NS_sys_time.h>
+
 /*********************************************************/
 /***            BATTLEGROUND QUEUE SYSTEM              ***/
 /*********************************************************/
@@ -43,6 +45,10 @@ BattlegroundQueue::BattlegroundQueue()
                 m_WaitTimes[i][j][k] = 0;
         }
     }
+
+    for (uint32 i = 0; i < MAX_BATTLEGROUND_BRACKETS; ++i)
+        for (uint32 j = 0; j < BG_QUEUE_GROUP_TYPES_COUNT; ++j)
+            m_WaitingPlayers[i][j] = 0;
 }
 
 BattlegroundQueue::~BattlegroundQueue()
@@ -126,6 +132,69 @@ bool BattlegroundQueue::SelectionPool::AddGroup(GroupQueueInfo* ginfo, uint32 de
 /***               BATTLEGROUND QUEUES                 ***/
 /*********************************************************/
 
+void BattlegroundQueue::AddToQueue(GroupQueueInfo* ginfo, BattlegroundBracketId bracket_id, uint32 queueGroupType, bool front)
+{
+    ginfo->BracketId = bracket_id;
+    ginfo->QueueGroupType = queueGroupType;
+
+    if (front)
+        m_QueuedGroups[bracket_id][queueGroupType].push_front(ginfo);
+    else
+        m_QueuedGroups[bracket_id][queueGroupType].push_back(ginfo);
+
+    if (!ginfo->IsInvitedToBGInstanceGUID)
+        AddWaitingGroup(ginfo);
+}
+
+void BattlegroundQueue::RemoveFromQueue(GroupsQueueType::iterator itr)
+{
+    GroupQueueInfo* ginfo = *itr;
+    if (!ginfo->IsInvitedToBGInstanceGUID)
+        RemoveWaitingGroup(ginfo);
+
+    m_QueuedGroups[ginfo->BracketId][ginfo->QueueGroupType].erase(itr);
+}
+
+// moves the group to the front of another queue of its bracket
+void BattlegroundQueue::MoveToQueue(GroupQueueInfo* ginfo, uint32 queueGroupType)
+{
+    GroupsQueueType& queue = m_QueuedGroups[ginfo->BracketId][ginfo->QueueGroupType];
+    GroupsQueueType::iterator itr = std::find(queue.begin(), queue.end(), ginfo);
+    if (itr == queue.end())
+        return;
+
+    RemoveFromQueue(itr);
+    AddToQueue(ginfo, ginfo->BracketId, queueGroupType, true);
+}
+
+void BattlegroundQueue::AddWaitingGroup(GroupQueueInfo* ginfo)
+{
+    m_WaitingPlayers[ginfo->BracketId][ginfo->QueueGroupType] += ginfo->Players.size();
+
+    // rated teams only ever wait in the premade queues
+    if (ginfo->IsRated && ginfo->QueueGroupType < BG_QUEUE_NORMAL_ALLIANCE)
+        m_RatedGroups[ginfo->BracketId][ginfo->QueueGroupType].insert(RatedGroupsIndex::value_type(ginfo->ArenaMatchmakerRating, ginfo));
+}
+
+void BattlegroundQueue::RemoveWaitingGroup(GroupQueueInfo* ginfo)
+{
+    m_WaitingPlayers[ginfo->BracketId][ginfo->QueueGroupType] -= ginfo->Players.size();
+
+    if (ginfo->IsRated && ginfo->QueueGroupType < BG_QUEUE_NORMAL_ALLIANCE)
+    {
+        RatedGroupsIndex& index = m_RatedGroups[ginfo->BracketId][ginfo->QueueGroupType];
+        std::pair<RatedGroupsIndex::iterator, RatedGroupsIndex::iterator> bounds = index.equal_range(ginfo->ArenaMatchmakerRating);
+        for (RatedGroupsIndex::iterator itr = bounds.first; itr != bounds.second; ++itr)
+        {
+            if (itr->second == ginfo)
+            {
+                index.erase(itr);
+                break;
+            }
+        }
+    }
+}
+
 // add group or player (grp == NULL) to bg queue with the given leader and bg specifications
 GroupQueueInfo* BattlegroundQueue::AddGroup(Player* leader, Group* grp, BattlegroundTypeId BgTypeId, PvPDifficultyEntry const*  bracketEntry, uint8 ArenaType, bool isRated, bool isPremade, uint32 ArenaRating, uint32 MatchmakerRating, uint32 arenateamid)
 {
@@ -192,7 +261,7 @@ GroupQueueInfo* BattlegroundQueue::AddGroup(Player* leader, Group* grp, Battlegr
     //add GroupInfo to m_QueuedGroups
     {
         //ACE_Guard<ACE_Recursive_Thread_Mutex> guard(m_Lock);
-        m_QueuedGroups[bracketId][index].push_back(ginfo);
+        AddToQueue(ginfo, bracketId, index, false);
 
         //announce to world, this code needs mutex
         if (!isRated && !isPremade && sWorld->getBoolConfig(CONFIG_BATTLEGROUND_QUEUE_ANNOUNCER_ENABLE))
@@ -201,17 +270,10 @@ GroupQueueInfo* BattlegroundQueue::AddGroup(Player* leader, Group* grp, Battlegr
             {
                 char const* bgName = bg->GetName();
                 uint32 MinPlayers = bg->GetMinPlayersPerTeam();
-                uint32 qHorde = 0;
-                uint32 qAlliance = 0;
+                uint32 qHorde = GetWaitingPlayers(bracketId, BG_QUEUE_NORMAL_HORDE);
+                uint32 qAlliance = GetWaitingPlayers(bracketId, BG_QUEUE_NORMAL_ALLIANCE);
                 uint32 q_min_level = bracketEntry->minLevel;
                 uint32 q_max_level = bracketEntry->maxLevel;
-                GroupsQueueType::const_iterator itr;
-                for (itr = m_QueuedGroups[bracketId][BG_QUEUE_NORMAL_ALLIANCE].begin(); itr != m_QueuedGroups[bracketId][BG_QUEUE_NORMAL_ALLIANCE].end(); ++itr)
-                    if (!(*itr)->IsInvitedToBGInstanceGUID)
-                        qAlliance += (*itr)->Players.size();
-                for (itr = m_QueuedGroups[bracketId][BG_QUEUE_NORMAL_HORDE].begin(); itr != m_QueuedGroups[bracketId][BG_QUEUE_NORMAL_HORDE].end(); ++itr)
-                    if (!(*itr)->IsInvitedToBGInstanceGUID)
-                        qHorde += (*itr)->Players.size();
 
                 // Show queue status to player only (when joining queue)
                 if (sWorld->getBoolConfig(CONFIG_BATTLEGROUND_QUEUE_ANNOUNCER_PLAYERONLY))
@@ -274,6 +336,11 @@ uint32 BattlegroundQueue::GetAverageQueueWaitTime(GroupQueueInfo* ginfo, Battleg
         if (ginfo->IsRated)
             team_index = TEAM_HORDE;                     //for rated arenas use TEAM_HORDE
     }
+    return GetAverageQueueWaitTime(team_index, bracket_id);
+}
+
+uint32 BattlegroundQueue::GetAverageQueueWaitTime(uint8 team_index, BattlegroundBracketId bracket_id) const
+{
     //check if there is enought values(we always add values > 0)
     if (m_WaitTimes[team_index][bracket_id][COUNT_OF_PLAYERS_TO_AVERAGE_WAIT_TIME - 1])
         return (m_SumOfWaitTimes[team_index][bracket_id] / COUNT_OF_PLAYERS_TO_AVERAGE_WAIT_TIME);
@@ -285,7 +352,6 @@ uint32 BattlegroundQueue::GetAverageQueueWaitTime(GroupQueueInfo* ginfo, Battleg
 //remove player from queue and from group info, if group info is empty then remove it too
 void BattlegroundQueue::RemovePlayer(uint64 guid, bool decreaseInvitedCount)
 {
-    int32 bracket_id = -1;                                     // signed for proper for-loop finish
     QueuedPlayersMap::iterator itr;
 
     //remove player from map, if he's there
@@ -300,40 +366,17 @@ void BattlegroundQueue::RemovePlayer(uint64 guid, bool decreaseInvitedCount)
     }
 
     GroupQueueInfo* group = itr->second.GroupInfo;
-    GroupsQueueType::iterator group_itr;
-    // mostly people with the highest levels are in battlegrounds, thats why
-    // we count from MAX_BATTLEGROUND_QUEUES - 1 to 0
-
-    uint32 index = (group->Team == HORDE) ? BG_QUEUE_PREMADE_HORDE : BG_QUEUE_PREMADE_ALLIANCE;
-
-    for (int32 bracket_id_tmp = MAX_BATTLEGROUND_BRACKETS - 1; bracket_id_tmp >= 0 && bracket_id == -1; --bracket_id_tmp)
-    {
-        //we must check premade and normal team's queue - because when players from premade are joining bg,
-        //they leave groupinfo so we can't use its players size to find out index
-        for (uint32 j = index; j < BG_QUEUE_GROUP_TYPES_COUNT; j += BG_TEAMS_COUNT)
-        {
-            GroupsQueueType::iterator k = m_QueuedGroups[bracket_id_tmp][j].begin();
-            for (; k != m_QueuedGroups[bracket_id_tmp][j].end(); ++k)
-            {
-                if ((*k) == group)
-                {
-                    bracket_id = bracket_id_tmp;
-                    group_itr = k;
-                    //we must store index to be able to erase iterator
-                    index = j;
-                    break;
-                }
-            }
-        }
-    }
+    // the group knows the queue it is stored in, whatever moves it made between premade and normal queues
+    GroupsQueueType& queue = m_QueuedGroups[group->BracketId][group->QueueGroupType];
+    GroupsQueueType::iterator group_itr = std::find(queue.begin(), queue.end(), group);
 
     //player can't be in queue without group, but just in case
-    if (bracket_id == -1)
+    if (group_itr == queue.end())
     {
         TC_LOG_ERROR(LOG_FILTER_BATTLEGROUND, "BattlegroundQueue: ERROR Cannot find groupinfo for player GUID: %u", GUID_LOPART(guid));
         return;
     }
-    TC_LOG_DEBUG(LOG_FILTER_BATTLEGROUND, "BattlegroundQueue: Removing player GUID %u, from bracket_id %u", GUID_LOPART(guid), (uint32)bracket_id);
+    TC_LOG_DEBUG(LOG_FILTER_BATTLEGROUND, "BattlegroundQueue: Removing player GUID %u, from bracket_id %u", GUID_LOPART(guid), uint32(group->BracketId));
 
     // ALL variables are correctly set
     // We can ignore leveling up in queue - it should not cause crash
@@ -343,7 +386,11 @@ void BattlegroundQueue::RemovePlayer(uint64 guid, bool decreaseInvitedCount)
     // remove player queue info from group queue info
     std::map<uint64, PlayerQueueInfo*>::iterator pitr = group->Players.find(guid);
     if (pitr != group->Players.end())
+    {
         group->Players.erase(pitr);
+        if (!group->IsInvitedToBGInstanceGUID)
+            --m_WaitingPlayers[group->BracketId][group->QueueGroupType];
+    }
 
     // if invited to bg, and should decrease invited count, then do it
     if (decreaseInvitedCount && group->IsInvitedToBGInstanceGUID)
@@ -375,7 +422,7 @@ void BattlegroundQueue::RemovePlayer(uint64 guid, bool decreaseInvitedCount)
     // remove group queue info if needed
     if (group->Players.empty())
     {
-        m_QueuedGroups[bracket_id][index].erase(group_itr);
+        RemoveFromQueue(group_itr);
         delete group;
         return;
     }
@@ -435,6 +482,8 @@ bool BattlegroundQueue::InviteGroupToBG(GroupQueueInfo* ginfo, Battleground* bg,
     if (!ginfo->IsInvitedToBGInstanceGUID)
     {
         // not yet invited
+        RemoveWaitingGroup(ginfo);
+
         // set invitation
         ginfo->IsInvitedToBGInstanceGUID = bg->GetInstanceID();
         BattlegroundTypeId bgTypeId = bg->GetTypeID();
@@ -616,12 +665,11 @@ bool BattlegroundQueue::CheckPremadeMatch(BattlegroundBracketId bracket_id, uint
     {
         if (!m_QueuedGroups[bracket_id][BG_QUEUE_PREMADE_ALLIANCE + i].empty())
         {
-            GroupsQueueType::iterator itr = m_QueuedGroups[bracket_id][BG_QUEUE_PREMADE_ALLIANCE + i].begin();
-            if (!(*itr)->IsInvitedToBGInstanceGUID && ((*itr)->JoinTime < time_before || (*itr)->Players.size() < MinPlayersPerTeam))
+            GroupQueueInfo* ginfo = m_QueuedGroups[bracket_id][BG_QUEUE_PREMADE_ALLIANCE + i].front();
+            if (!ginfo->IsInvitedToBGInstanceGUID && (ginfo->JoinTime < time_before || ginfo->Players.size() < MinPlayersPerTeam))
             {
                 //we must insert group to normal queue and erase pointer from premade queue
-                m_QueuedGroups[bracket_id][BG_QUEUE_NORMAL_ALLIANCE + i].push_front((*itr));
-                m_QueuedGroups[bracket_id][BG_QUEUE_PREMADE_ALLIANCE + i].erase(itr);
+                MoveToQueue(ginfo, BG_QUEUE_NORMAL_ALLIANCE + i);
             }
         }
     }
@@ -714,19 +762,8 @@ bool BattlegroundQueue::CheckSkirmishForSameFaction(BattlegroundBracketId bracke
     {
         //set correct team
         (*itr)->Team = otherTeamId;
-        //add team to other queue
-        m_QueuedGroups[bracket_id][BG_QUEUE_NORMAL_ALLIANCE + otherTeam].push_front(*itr);
-        //remove team from old queue
-        GroupsQueueType::iterator itr2 = itr_team;
-        ++itr2;
-        for (; itr2 != m_QueuedGroups[bracket_id][BG_QUEUE_NORMAL_ALLIANCE + teamIndex].end(); ++itr2)
-        {
-            if (*itr2 == *itr)
-            {
-                m_QueuedGroups[bracket_id][BG_QUEUE_NORMAL_ALLIANCE + teamIndex].erase(itr2);
-                break;
-            }
-        }
+        //move team to other queue, erasing from the middle of a deque invalidates itr_team so it is not used anymore
+        MoveToQueue(*itr, BG_QUEUE_NORMAL_ALLIANCE + otherTeam);
     }
     return true;
 }
@@ -742,6 +779,20 @@ it must be called after fully adding the members of a group to ensure group join
 should be called from Battleground::RemovePlayer function in some cases
 */
 void BattlegroundQueue::BattlegroundQueueUpdate(uint32 /*diff*/, BattlegroundTypeId bgTypeId, BattlegroundBracketId bracket_id, uint8 arenaType, bool isRated, uint32 arenaRating)
+{
+    ACE_Time_Value startTime = ACE_OS::gettimeofday();
+
+    FindMatches(bgTypeId, bracket_id, arenaType, isRated, arenaRating);
+
+    ACE_UINT64 elapsed = 0;
+    (ACE_OS::gettimeofday() - startTime).to_usec(elapsed);
+
+    ++m_Stats.Updates;
+    m_Stats.MatcherTime += elapsed;
+    m_Stats.MaxMatcherTime = std::max(m_Stats.MaxMatcherTime, uint32(elapsed));
+}
+
+void BattlegroundQueue::FindMatches(BattlegroundTypeId bgTypeId, BattlegroundBracketId bracket_id, uint8 arenaType, bool isRated, uint32 arenaRating)
 {
     //if no players in queue - do nothing
     if (m_QueuedGroups[bracket_id][BG_QUEUE_PREMADE_ALLIANCE].empty() &&
@@ -755,6 +806,10 @@ void BattlegroundQueue::BattlegroundQueueUpdate(uint32 /*diff*/, BattlegroundTyp
     BGFreeSlotQueueContainer& bgQueues = sBattlegroundMgr->GetBGFreeSlotQueueStore(bgTypeId);
     for (BGFreeSlotQueueContainer::iterator itr = bgQueues.begin(); itr != bgQueues.end();)
     {
+        // only not invited groups of the normal queues can fill free slots
+        if (!GetWaitingPlayers(bracket_id, BG_QUEUE_NORMAL_ALLIANCE) && !GetWaitingPlayers(bracket_id, BG_QUEUE_NORMAL_HORDE))
+            break;
+
         Battleground* bg = *itr; ++itr;
         // DO NOT allow queue manager to invite new player to rated games
         if (!bg->isRated() && bg->GetTypeID() == bgTypeId && bg->GetBracketId() == bracket_id &&
@@ -827,6 +882,7 @@ void BattlegroundQueue::BattlegroundQueueUpdate(uint32 /*diff*/, BattlegroundTyp
                     InviteGroupToBG((*citr), bg2, (*citr)->Team);
 
             bg2->StartBattleground();
+            ++m_Stats.MatchesStarted;
             //clear structures
             m_SelectionPools[TEAM_ALLIANCE].Init();
             m_SelectionPools[TEAM_HORDE].Init();
@@ -836,6 +892,16 @@ void BattlegroundQueue::BattlegroundQueueUpdate(uint32 /*diff*/, BattlegroundTyp
     // now check if there are in queues enough players to start new game of (normal battleground, or non-rated arena)
     if (!isRated)
     {
+        // selection pools only take not invited groups, so without enough of them on either side no match can form
+        uint32 waitingAlliance = GetWaitingPlayers(bracket_id, BG_QUEUE_NORMAL_ALLIANCE);
+        uint32 waitingHorde = GetWaitingPlayers(bracket_id, BG_QUEUE_NORMAL_HORDE);
+        if (waitingAlliance < MinPlayersPerTeam && waitingHorde < MinPlayersPerTeam
+            && !(sBattlegroundMgr->isTesting() && bg_template->isBattleground() && (waitingAlliance || waitingHorde)))
+        {
+            ++m_Stats.SkippedSearches;
+            return;
+        }
+
         // if there are enough players in pools, start new battleground or non rated arena
         if (CheckNormalMatch(bg_template, bracket_id, MinPlayersPerTeam, MaxPlayersPerTeam)
             || (bg_template->isArena() && CheckSkirmishForSameFaction(bracket_id, MinPlayersPerTeam)))
@@ -854,6 +920,7 @@ void BattlegroundQueue::BattlegroundQueueUpdate(uint32 /*diff*/, BattlegroundTyp
                     InviteGroupToBG((*citr), bg2, (*citr)->Team);
             // start bg
             bg2->StartBattleground();
+            ++m_Stats.MatchesStarted;
         }
     }
     else if (bg_template->isArena())
@@ -894,25 +961,17 @@ void BattlegroundQueue::BattlegroundQueueUpdate(uint32 /*diff*/, BattlegroundTyp
         uint32 discardTime = getMSTime() - sBattlegroundMgr->GetRatingDiscardTimer();
 
         // we need to find 2 teams which will play next game
-        GroupsQueueType::iterator itr_teams[BG_TEAMS_COUNT];
+        GroupQueueInfo* teams[BG_TEAMS_COUNT];
         uint8 found = 0;
         uint8 team = 0;
 
         for (uint8 i = BG_QUEUE_PREMADE_ALLIANCE; i < BG_QUEUE_NORMAL_ALLIANCE; i++)
         {
             // take the group that joined first
-            GroupsQueueType::iterator itr2 = m_QueuedGroups[bracket_id][i].begin();
-            for (; itr2 != m_QueuedGroups[bracket_id][i].end(); ++itr2)
+            if (GroupQueueInfo* ginfo = SelectRatedTeam(bracket_id, i, arenaMinRating, arenaMaxRating, discardTime, NULL))
             {
-                // if group match conditions, then add it to pool
-                if (!(*itr2)->IsInvitedToBGInstanceGUID
-                    && (((*itr2)->ArenaMatchmakerRating >= arenaMinRating && (*itr2)->ArenaMatchmakerRating <= arenaMaxRating)
-                        || (*itr2)->JoinTime < discardTime))
-                {
-                    itr_teams[found++] = itr2;
-                    team = i;
-                    break;
-                }
+                teams[found++] = ginfo;
+                team = i;
             }
         }
 
@@ -920,25 +979,14 @@ void BattlegroundQueue::BattlegroundQueueUpdate(uint32 /*diff*/, BattlegroundTyp
             return;
 
         if (found == 1)
-        {
-            for (GroupsQueueType::iterator itr3 = itr_teams[0]; itr3 != m_QueuedGroups[bracket_id][team].end(); ++itr3)
-            {
-                if (!(*itr3)->IsInvitedToBGInstanceGUID
-                    && (((*itr3)->ArenaMatchmakerRating >= arenaMinRating && (*itr3)->ArenaMatchmakerRating <= arenaMaxRating)
-                        || (*itr3)->JoinTime < discardTime)
-                    && (*itr_teams[0])->ArenaTeamId != (*itr3)->ArenaTeamId)
-                {
-                    itr_teams[found++] = itr3;
-                    break;
-                }
-            }
-        }
+            if (GroupQueueInfo* ginfo = SelectRatedTeam(bracket_id, team, arenaMinRating, arenaMaxRating, discardTime, teams[0]))
+                teams[found++] = ginfo;
 
         //if we have 2 teams, then start new arena and invite players!
         if (found == 2)
         {
-            GroupQueueInfo* aTeam = *itr_teams[TEAM_ALLIANCE];
-            GroupQueueInfo* hTeam = *itr_teams[TEAM_HORDE];
+            GroupQueueInfo* aTeam = teams[TEAM_ALLIANCE];
+            GroupQueueInfo* hTeam = teams[TEAM_HORDE];
             Battleground* arena = sBattlegroundMgr->CreateNewBattleground(bgTypeId, bracketEntry, arenaType, true);
             if (!arena)
             {
@@ -953,17 +1001,11 @@ void BattlegroundQueue::BattlegroundQueueUpdate(uint32 /*diff*/, BattlegroundTyp
             TC_LOG_DEBUG(LOG_FILTER_BATTLEGROUND, "setting oposite teamrating for team %u to %u", aTeam->ArenaTeamId, aTeam->OpponentsTeamRating);
             TC_LOG_DEBUG(LOG_FILTER_BATTLEGROUND, "setting oposite teamrating for team %u to %u", hTeam->ArenaTeamId, hTeam->OpponentsTeamRating);
 
-            // now we must move team if we changed its faction to another faction queue, because then we will spam log by errors in Queue::RemovePlayer
-            if (aTeam->Team != ALLIANCE)
-            {
-                m_QueuedGroups[bracket_id][BG_QUEUE_PREMADE_ALLIANCE].push_front(aTeam);
-                m_QueuedGroups[bracket_id][BG_QUEUE_PREMADE_HORDE].erase(itr_teams[TEAM_ALLIANCE]);
-            }
-            if (hTeam->Team != HORDE)
-            {
-                m_QueuedGroups[bracket_id][BG_QUEUE_PREMADE_HORDE].push_front(hTeam);
-                m_QueuedGroups[bracket_id][BG_QUEUE_PREMADE_ALLIANCE].erase(itr_teams[TEAM_HORDE]);
-            }
+            // now we must move team if we changed its faction to another faction queue, so the queue matches the team it is invited as
+            if (aTeam->QueueGroupType != BG_QUEUE_PREMADE_ALLIANCE)
+                MoveToQueue(aTeam, BG_QUEUE_PREMADE_ALLIANCE);
+            if (hTeam->QueueGroupType != BG_QUEUE_PREMADE_HORDE)
+                MoveToQueue(hTeam, BG_QUEUE_PREMADE_HORDE);
 
             arena->SetArenaMatchmakerRating(ALLIANCE, aTeam->ArenaMatchmakerRating);
             arena->SetArenaMatchmakerRating(   HORDE, hTeam->ArenaMatchmakerRating);
@@ -972,8 +1014,50 @@ void BattlegroundQueue::BattlegroundQueueUpdate(uint32 /*diff*/, BattlegroundTyp
 
             TC_LOG_DEBUG(LOG_FILTER_BATTLEGROUND, "Starting rated arena match!");
             arena->StartBattleground();
+            ++m_Stats.MatchesStarted;
+        }
+    }
+}
+
+/*
+returns the not invited rated team of the queue that joined first and can play in the rating range, or after the rating discard time any rating
+same as walking the queue in join order, the discard time can only pass for the oldest team first and the rating range is looked up in the rating index
+*/
+GroupQueueInfo* BattlegroundQueue::SelectRatedTeam(BattlegroundBracketId bracket_id, uint32 queueGroupType, uint32 minRating, uint32 maxRating, uint32 discardTime, GroupQueueInfo const* opponent)
+{
+    GroupsQueueType const& queue = m_QueuedGroups[bracket_id][queueGroupType];
+    for (GroupsQueueType::const_iterator itr = queue.begin(); itr != queue.end(); ++itr)
+    {
+        GroupQueueInfo* ginfo = *itr;
+        if (ginfo->IsInvitedToBGInstanceGUID || (opponent && ginfo->ArenaTeamId == opponent->ArenaTeamId))
+            continue;
+
+        if (ginfo->JoinTime < discardTime)
+            return ginfo;
+        break;
+    }
+
+    uint32 now = getMSTime();
+    GroupQueueInfo* selected = NULL;
+    uint32 selectedWaitTime = 0;
+
+    RatedGroupsIndex const& index = m_RatedGroups[bracket_id][queueGroupType];
+    RatedGroupsIndex::const_iterator end = index.upper_bound(maxRating);
+    for (RatedGroupsIndex::const_iterator itr = index.lower_bound(minRating); itr != end; ++itr)
+    {
+        GroupQueueInfo* ginfo = itr->second;
+        if (opponent && ginfo->ArenaTeamId == opponent->ArenaTeamId)
+            continue;
+
+        uint32 waitTime = getMSTimeDiff(ginfo->JoinTime, now);
+        if (!selected || waitTime > selectedWaitTime)
+        {
+            selected = ginfo;
+            selectedWaitTime = waitTime;
         }
     }
+
+    return selected;
 }
 
 /*********************************************************/
@@ -53,6 +53,8 @@ struct GroupQueueInfo                                       // stores informatio
     uint32  ArenaMatchmakerRating;                          // if rated match, inited to the rating of the team
     uint32  OpponentsTeamRating;                            // for rated arena matches
     uint32  OpponentsMatchmakerRating;                      // for rated arena matches
+    BattlegroundBracketId BracketId;                        // bracket of the queue the group is stored in
+    uint8   QueueGroupType;                                 // BattlegroundQueueGroupTypes of the queue the group is stored in
 };
 
 enum BattlegroundQueueGroupTypes
@@ -64,6 +66,17 @@ enum BattlegroundQueueGroupTypes
 };
 #define BG_QUEUE_GROUP_TYPES_COUNT 4
 
+struct BattlegroundQueueStats
+{
+    BattlegroundQueueStats() : Updates(0), SkippedSearches(0), MatcherTime(0), MaxMatcherTime(0), MatchesStarted(0) { }
+
+    uint32 Updates;                                         // BattlegroundQueueUpdate calls
+    uint32 SkippedSearches;                                 // new match searches left out because too few players wait
+    uint64 MatcherTime;                                     // microseconds spent in BattlegroundQueueUpdate
+    uint32 MaxMatcherTime;                                  // longest single update, in microseconds
+    uint32 MatchesStarted;                                  // battlegrounds and arenas started by the queue
+};
+
 class Battleground;
 class BattlegroundQueue
 {
@@ -84,6 +97,11 @@ class BattlegroundQueue
         bool GetPlayerGroupInfoData(uint64 guid, GroupQueueInfo* ginfo);
         void PlayerInvitedToBGUpdateAverageWaitTime(GroupQueueInfo* ginfo, BattlegroundBracketId bracket_id);
         uint32 GetAverageQueueWaitTime(GroupQueueInfo* ginfo, BattlegroundBracketId bracket_id) const;
+        uint32 GetAverageQueueWaitTime(uint8 team_index, BattlegroundBracketId bracket_id) const;
+
+        // players of the groups in the given queue that are not invited yet
+        uint32 GetWaitingPlayers(BattlegroundBracketId bracket_id, uint32 queueGroupType) const { return m_WaitingPlayers[bracket_id][queueGroupType]; }
+        BattlegroundQueueStats const& GetStats() const { return m_Stats; }
 
         typedef std::map<uint64, PlayerQueueInfo> QueuedPlayersMap;
         QueuedPlayersMap m_QueuedPlayers;
@@ -121,8 +139,26 @@ class BattlegroundQueue
         SelectionPool m_SelectionPools[BG_TEAMS_COUNT];
         uint32 GetPlayersInQueue(TeamId id);
     private:
+        void FindMatches(BattlegroundTypeId bgTypeId, BattlegroundBracketId bracket_id, uint8 arenaType, bool isRated, uint32 arenaRating);
+        GroupQueueInfo* SelectRatedTeam(BattlegroundBracketId bracket_id, uint32 queueGroupType, uint32 minRating, uint32 maxRating, uint32 discardTime, GroupQueueInfo const* opponent);
+
+        // all changes of m_QueuedGroups go through these, they keep the waiting counts and the rating index in sync
+        void AddToQueue(GroupQueueInfo* ginfo, BattlegroundBracketId bracket_id, uint32 queueGroupType, bool front);
+        void RemoveFromQueue(GroupsQueueType::iterator itr);
+        void MoveToQueue(GroupQueueInfo* ginfo, uint32 queueGroupType);
+        void AddWaitingGroup(GroupQueueInfo* ginfo);
+        void RemoveWaitingGroup(GroupQueueInfo* ginfo);
 
         bool InviteGroupToBG(GroupQueueInfo* ginfo, Battleground* bg, uint32 side);
+
+        // not invited players per queue, lets an update skip searches that can't form a match
+        uint32 m_WaitingPlayers[MAX_BATTLEGROUND_BRACKETS][BG_QUEUE_GROUP_TYPES_COUNT];
+
+        // not invited rated arena teams by matchmaker rating, per premade queue
+        typedef std::multimap<uint32, GroupQueueInfo*> RatedGroupsIndex;
+        RatedGroupsIndex m_RatedGroups[MAX_BATTLEGROUND_BRACKETS][BG_TEAMS_COUNT];
+
+        BattlegroundQueueStats m_Stats;
         uint32 m_WaitTimes[BG_TEAMS_COUNT][MAX_BATTLEGROUND_BRACKETS][COUNT_OF_PLAYERS_TO_AVERAGE_WAIT_TIME];
         uint32 m_WaitTimeLastPlayer[BG_TEAMS_COUNT][MAX_BATTLEGROUND_BRACKETS];
         uint32 m_SumOfWaitTimes[BG_TEAMS_COUNT][MAX_BATTLEGROUND_BRACKETS];
@@ -16,6 +16,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "WorldSocket.h"                                    // must be first to make ACE happy with ACE includes in it
 #include "Channel.h"
 #include "Chat.h"
 #include "ObjectMgr.h"
@@ -25,6 +26,38 @@
 #include "AccountMgr.h"
 #include "Player.h"
 
+namespace
+{
+    // sends one packet to many members, large packets are copied once and shared by all sockets
+    class ChannelPacketSender
+    {
+        public:
+            explicit ChannelPacketSender(WorldPacket const* data) : _data(data), _payload(NULL) { }
+            ~ChannelPacketSender() { delete _payload; }
+
+            void Send(WorldSession* session)
+            {
+                if (_data->size() < SHARED_PACKET_MIN_SIZE)
+                {
+                    session->SendPacket(_data);
+                    return;
+                }
+
+                if (!_payload)
+                    _payload = new SharedPacketPayload(*_data);
+
+                session->SendPacket(*_payload);
+            }
+
+        private:
+            ChannelPacketSender(ChannelPacketSender const&);
+            ChannelPacketSender& operator=(ChannelPacketSender const&);
+
+            WorldPacket const* _data;
+            SharedPacketPayload* _payload;
+    };
+}
+
 Channel::Channel(std::string const& name, uint32 channelId, uint32 team):
     _announce(true),
     _ownership(true),
@@ -201,6 +234,7 @@ void Channel::JoinChannel(Player* player, std::string const& pass)
     PlayerInfo pinfo;
     pinfo.player = guid;
     pinfo.flags = MEMBER_FLAG_NONE;
+    pinfo.plrPtr = player;
     playersStore[guid] = pinfo;
 
     WorldPacket data;
@@ -543,7 +577,7 @@ void Channel::List(Player const* player)
     uint32 count  = 0;
     for (PlayerContainer::const_iterator i = playersStore.begin(); i != playersStore.end(); ++i)
     {
-        Player* member = ObjectAccessor::FindPlayer(i->first);
+        Player* member = i->second.plrPtr;
 
         // PLAYER can't see MODERATOR, GAME MASTER, ADMINISTRATOR characters
         // MODERATOR, GAME MASTER, ADMINISTRATOR can see all
@@ -729,25 +763,35 @@ void Channel::SetOwner(uint64 guid, bool exclaim)
     }
 }
 
+// members are reached through their stored player, no global player lookup per member
 void Channel::SendToAll(WorldPacket* data, uint64 guid)
 {
+    ChannelPacketSender sender(data);
     for (PlayerContainer::const_iterator i = playersStore.begin(); i != playersStore.end(); ++i)
-        if (Player* player = ObjectAccessor::FindPlayer(i->first))
+        if (Player* player = i->second.plrPtr)
             if (!guid || !player->GetSocial()->HasIgnore(GUID_LOPART(guid)))
-                player->GetSession()->SendPacket(data);
+                sender.Send(player->GetSession());
 }
 
 void Channel::SendToAllButOne(WorldPacket* data, uint64 who)
 {
+    ChannelPacketSender sender(data);
     for (PlayerContainer::const_iterator i = playersStore.begin(); i != playersStore.end(); ++i)
         if (i->first != who)
-            if (Player* player = ObjectAccessor::FindPlayer(i->first))
-                player->GetSession()->SendPacket(data);
+            if (Player* player = i->second.plrPtr)
+                sender.Send(player->GetSession());
 }
 
 void Channel::SendToOne(WorldPacket* data, uint64 who)
 {
-    if (Player* player = ObjectAccessor::FindPlayer(who))
+    PlayerContainer::const_iterator itr = playersStore.find(who);
+    Player* player = itr != playersStore.end() ? itr->second.plrPtr : NULL;
+
+    // also used for answers to players not on the channel
+    if (!player)
+        player = ObjectAccessor::FindPlayer(who);
+
+    if (player)
         player->GetSession()->SendPacket(data);
 }
 
@@ -122,8 +122,11 @@ class Channel
 {
     struct PlayerInfo
     {
+        PlayerInfo() : player(0), flags(MEMBER_FLAG_NONE), plrPtr(NULL) { }
+
         uint64 player;
         uint8 flags;
+        Player* plrPtr;                                     // valid while on the channel, Player::CleanupChannels leaves all channels at logout
 
         bool HasFlag(uint8 flag) const { return flags & flag; }
         void SetFlag(uint8 flag) { if (!HasFlag(flag)) flags |= flag; }
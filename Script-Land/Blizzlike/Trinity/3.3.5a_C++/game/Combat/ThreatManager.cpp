@@ -27,6 +27,8 @@
 #include "SpellAuras.h"
 #include "SpellMgr.h"
 
+#include <algorithm>
+
 //==============================================================
 //================= ThreatCalcHelper ===========================
 //==============================================================
@@ -99,6 +101,7 @@ HostileReference::HostileReference(Unit* refUnit, ThreatManager* threatManager,
     iUnitGuid = refUnit->GetGUID();
     iOnline = true;
     iAccessible = true;
+    iChangeQueued = false;
 }
 
 //============================================================
@@ -260,6 +263,91 @@ void ThreatContainer::clearReferences()
     }
 
     iThreatList.clear();
+    iChanged.clear();
+    iSize = 0;
+
+    delete iIndex;
+    iIndex = NULL;
+}
+
+//============================================================
+
+ThreatContainer::StorageType::iterator ThreatContainer::find(uint64 guid)
+{
+    if (iIndex)
+    {
+        IndexType::const_iterator itr = iIndex->find(guid);
+        return itr != iIndex->end() ? itr->second : iThreatList.end();
+    }
+
+    for (StorageType::iterator i = iThreatList.begin(); i != iThreatList.end(); ++i)
+        if ((*i)->getUnitGuid() == guid)
+            return i;
+
+    return iThreatList.end();
+}
+
+void ThreatContainer::buildIndex()
+{
+    iIndex = new IndexType();
+    for (StorageType::iterator i = iThreatList.begin(); i != iThreatList.end(); ++i)
+        (*iIndex)[(*i)->getUnitGuid()] = i;
+}
+
+void ThreatContainer::addReference(HostileReference* hostileRef)
+{
+    StorageType::iterator pos = iThreatList.insert(iThreatList.end(), hostileRef);
+    ++iSize;
+
+    if (iIndex)
+        (*iIndex)[hostileRef->getUnitGuid()] = pos;
+    else if (iSize > THREAT_INDEX_MIN_SIZE)
+        buildIndex();
+
+    markChanged(hostileRef);
+}
+
+void ThreatContainer::remove(HostileReference* hostileRef)
+{
+    StorageType::iterator pos = find(hostileRef->getUnitGuid());
+    if (pos == iThreatList.end())
+        return;
+
+    iThreatList.erase(pos);
+    --iSize;
+
+    // the reference may join the other container, which keeps its own changed list
+    if (hostileRef->iChangeQueued)
+    {
+        hostileRef->iChangeQueued = false;
+        std::vector<uint64>::iterator queued = std::find(iChanged.begin(), iChanged.end(), hostileRef->getUnitGuid());
+        if (queued != iChanged.end())
+        {
+            *queued = iChanged.back();
+            iChanged.pop_back();
+        }
+    }
+
+    if (iIndex)
+    {
+        iIndex->erase(hostileRef->getUnitGuid());
+        // shrunk well below the threshold, drop the index (keeps a hysteresis against flapping)
+        if (iSize <= THREAT_INDEX_MIN_SIZE / 2)
+        {
+            delete iIndex;
+            iIndex = NULL;
+        }
+    }
+}
+
+void ThreatContainer::markChanged(HostileReference* hostileRef)
+{
+    // queued once per update, so iChanged never outgrows the list
+    if (iOrdered && !hostileRef->iChangeQueued)
+    {
+        hostileRef->iChangeQueued = true;
+        iChanged.push_back(hostileRef->getUnitGuid());
+    }
 }
 
 //============================================================
@@ -269,15 +357,8 @@ HostileReference* ThreatContainer::getReferenceByTarget(Unit* victim) const
     if (!victim)
         return NULL;
 
-    uint64 const guid = victim->GetGUID();
-    for (ThreatContainer::StorageType::const_iterator i = iThreatList.begin(); i != iThreatList.end(); ++i)
-    {
-        HostileReference* ref = (*i);
-        if (ref && ref->getUnitGuid() == guid)
-            return ref;
-    }
-
-    return NULL;
+    StorageType::iterator pos = const_cast<ThreatContainer*>(this)->find(victim->GetGUID());
+    return pos != iThreatList.end() ? *pos : NULL;
 }
 
 //============================================================
@@ -304,9 +385,51 @@ void ThreatContainer::modifyThreatPercent(Unit* victim, int32 percent)
 
 void ThreatContainer::update()
 {
-    if (iDirty && iThreatList.size() > 1)
-        iThreatList.sort(Trinity::ThreatOrderPred());
+    if (!iDirty && iChanged.empty())
+        return;
+
+    // many references moved (raid wide threat wipe, first pull), sorting everything is cheaper
+    if (iDirty || iChanged.size() * 4 > iSize)
+    {
+        for (StorageType::const_iterator itr = iThreatList.begin(); itr != iThreatList.end(); ++itr)
+            (*itr)->iChangeQueued = false;
 
+        if (iSize > 1)
+            iThreatList.sort(Trinity::ThreatOrderPred());
+    }
+    else
+    {
+        // take the changed references out, the rest of the list is still ordered
+        StorageType moved;
+        for (std::vector<uint64>::const_iterator itr = iChanged.begin(); itr != iChanged.end(); ++itr)
+        {
+            StorageType::iterator pos = find(*itr);
+            if (pos != iThreatList.end())
+            {
+                (*pos)->iChangeQueued = false;
+                moved.splice(moved.end(), iThreatList, pos);
+            }
+        }
+
+        // and put each one back in front of the first reference with less threat
+        while (!moved.empty())
+        {
+            float threat = moved.front()->getThreat();
+            StorageType::iterator dest = iThreatList.begin();
+            while (dest != iThreatList.end() && (*dest)->getThreat() >= threat)
+                ++dest;
+
+            iThreatList.splice(dest, moved, moved.begin());
+            if (iIndex)
+            {
+                StorageType::iterator pos = dest;
+                --pos;
+                (*iIndex)[(*pos)->getUnitGuid()] = pos;
+            }
+        }
+    }
+
+    iChanged.clear();
     iDirty = false;
 }
 
@@ -390,7 +513,8 @@ HostileReference* ThreatContainer::selectNextVictim(Creature* attacker, HostileR
 //=================== ThreatManager ==========================
 //============================================================
 
-ThreatManager::ThreatManager(Unit* owner) : iCurrentVictim(NULL), iOwner(owner), iUpdateTimer(THREAT_UPDATE_INTERVAL)
+ThreatManager::ThreatManager(Unit* owner) : iCurrentVictim(NULL), iOwner(owner), iUpdateTimer(THREAT_UPDATE_INTERVAL),
+    iThreatContainer(true), iThreatOfflineContainer(false)
 {
 }
 
@@ -525,9 +649,8 @@ void ThreatManager::processThreatEvent(ThreatRefStatusChangeEvent* threatRefStat
     switch (threatRefStatusChangeEvent->getType())
     {
         case UEV_THREAT_REF_THREAT_CHANGE:
-            if ((getCurrentVictim() == hostilRef && threatRefStatusChangeEvent->getFValue()<0.0f) ||
-                (getCurrentVictim() != hostilRef && threatRefStatusChangeEvent->getFValue()>0.0f))
-                setDirty(true);                             // the order in the threat list might have changed
+            if (hostilRef->isOnline())
+                iThreatContainer.markChanged(hostilRef);    // the order in the threat list might have changed
             break;
         case UEV_THREAT_REF_ONLINE_STATUS:
             if (!hostilRef->isOnline())
@@ -23,8 +23,10 @@
 #include "SharedDefines.h"
 #include "LinkedReference/Reference.h"
 #include "UnitEvents.h"
+#include "UnorderedMap.h"
 
 #include <list>
+#include <vector>
 
 //==============================================================
 
@@ -34,6 +36,7 @@ class ThreatManager;
 class SpellInfo;
 
 #define THREAT_UPDATE_INTERVAL 1 * IN_MILLISECONDS    // Server should send threat update to client periodically each second
+#define THREAT_INDEX_MIN_SIZE 16                      // threat lists longer than this get a guid index
 
 //==============================================================
 // Class to calculate the real threat based
@@ -125,6 +128,8 @@ class HostileReference : public Reference<Unit, ThreatManager>
         // Tell our refFrom (source) object, that the link is cut (Target destroyed)
         void sourceObjectDestroyLink();
     private:
+        friend class ThreatContainer;
+
         // Inform the source, that the status of that reference was changed
         void fireStatusChanged(ThreatRefStatusChangeEvent& threatRefStatusChangeEvent);
 
@@ -135,11 +140,18 @@ class HostileReference : public Reference<Unit, ThreatManager>
         uint64 iUnitGuid;
         bool iOnline;
         bool iAccessible;
+        bool iChangeQueued;                                 // already in the changed list of its container
 };
 
 //==============================================================
 class ThreatManager;
 
+// The online container keeps its list ordered by threat (highest first). A threat change
+// only queues the changed reference, update() then moves just the queued references to their
+// place instead of re-sorting the whole list; between two updates the list is left untouched,
+// so callers may still change threat while walking it.
+// Lists long enough to matter (world bosses, big open world fights) also keep a
+// guid -> position index, so finding the reference of a victim does not walk the list.
 class ThreatContainer
 {
         friend class ThreatManager;
@@ -147,7 +159,7 @@ class ThreatContainer
     public:
         typedef std::list<HostileReference*> StorageType;
 
-        ThreatContainer(): iDirty(false) { }
+        explicit ThreatContainer(bool ordered) : iIndex(NULL), iSize(0), iDirty(false), iOrdered(ordered) { }
 
         ~ThreatContainer() { clearReferences(); }
 
@@ -166,6 +178,8 @@ class ThreatContainer
             return iThreatList.empty();
         }
 
+        uint32 getSize() const { return iSize; }
+
         HostileReference* getMostHated() const
         {
             return iThreatList.empty() ? NULL : iThreatList.front();
@@ -176,15 +190,21 @@ class ThreatContainer
         StorageType const & getThreatList() const { return iThreatList; }
 
     private:
-        void remove(HostileReference* hostileRef)
-        {
-            iThreatList.remove(hostileRef);
-        }
+        typedef UNORDERED_MAP<uint64, StorageType::iterator> IndexType;
 
-        void addReference(HostileReference* hostileRef)
-        {
-            iThreatList.push_back(hostileRef);
-        }
+        ThreatContainer(ThreatContainer const&);
+        ThreatContainer& operator=(ThreatContainer const&);
+
+        void remove(HostileReference* hostileRef);
+
+        void addReference(HostileReference* hostileRef);
+
+        // Queue a reference whose threat changed, its position is fixed by the next update()
+        void markChanged(HostileReference* hostileRef);
+
+        StorageType::iterator find(uint64 guid);
+
+        void buildIndex();
 
         void clearReferences();
 
@@ -192,7 +212,11 @@ class ThreatContainer
         void update();
 
         StorageType iThreatList;
+        IndexType* iIndex;                                  // built once the list grows past THREAT_INDEX_MIN_SIZE
+        std::vector<uint64> iChanged;                       // guids of the references out of order, each queued once
+        uint32 iSize;                                       // std::list::size() is linear
         bool iDirty;
+        bool iOrdered;
 };
 
 //=================================================
@@ -218,6 +242,8 @@ class ThreatManager
 
         bool isThreatListEmpty() const { return iThreatContainer.empty(); }
 
+        uint32 getThreatListSize() const { return iThreatContainer.getSize(); }
+
         void processThreatEvent(ThreatRefStatusChangeEvent* threatRefStatusChangeEvent);
 
         bool isNeedUpdateToClient(uint32 time);
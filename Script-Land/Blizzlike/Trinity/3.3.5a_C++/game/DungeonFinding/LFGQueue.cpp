@@ -38,22 +38,105 @@ namespace lfg
 */
 std::string ConcatenateGuids(LfgGuidList const& check)
 {
-    if (check.empty())
-        return "";
+    return LfgGuidKey(check).ToString();
+}
 
-    // need the guids in order to avoid duplicates
-    LfgGuidSet guids(check.begin(), check.end());
+LfgGuidKey::LfgGuidKey(LfgGuidList const& check): size(0)
+{
+    ASSERT(check.size() <= LFG_GUID_KEY_MAX_SIZE);
 
-    std::ostringstream o;
+    // insertion sort, need the guids in order to avoid duplicates
+    for (LfgGuidList::const_iterator it = check.begin(); it != check.end(); ++it)
+    {
+        uint8 pos = 0;
+        while (pos < size && guids[pos] < *it)
+            ++pos;
+
+        if (pos < size && guids[pos] == *it)
+            continue;
+
+        for (uint8 i = size; i > pos; --i)
+            guids[i] = guids[i - 1];
 
-    LfgGuidSet::const_iterator it = guids.begin();
-    o << (*it);
-    for (++it; it != guids.end(); ++it)
-        o << '|' << (*it);
+        guids[pos] = *it;
+        ++size;
+    }
+}
+
+bool LfgGuidKey::Contains(uint64 guid) const
+{
+    for (uint8 i = 0; i < size; ++i)
+        if (guids[i] == guid)
+            return true;
+
+    return false;
+}
+
+uint64 LfgGuidKey::GetHash() const
+{
+    uint64 hash = size;
+    for (uint8 i = 0; i < size; ++i)
+        hash = (hash ^ guids[i]) * UI64LIT(0x9E3779B97F4A7C15);
+
+    return hash;
+}
+
+/// Guids using | as delimiter, for logs
+std::string LfgGuidKey::ToString() const
+{
+    std::ostringstream o;
+    for (uint8 i = 0; i < size; ++i)
+    {
+        if (i)
+            o << '|';
+        o << guids[i];
+    }
 
     return o.str();
 }
 
+bool LfgGuidKey::operator==(LfgGuidKey const& right) const
+{
+    if (size != right.size)
+        return false;
+
+    for (uint8 i = 0; i < size; ++i)
+        if (guids[i] != right.guids[i])
+            return false;
+
+    return true;
+}
+
+void LfgRolesSummary::Add(LfgRolesMap const& roles)
+{
+    for (LfgRolesMap::const_iterator it = roles.begin(); it != roles.end(); ++it)
+    {
+        ++players;
+        switch (it->second & ~PLAYER_ROLE_LEADER)
+        {
+            case PLAYER_ROLE_TANK:
+                ++tanks;
+                break;
+            case PLAYER_ROLE_HEALER:
+                ++healers;
+                break;
+            case PLAYER_ROLE_DAMAGE:
+                ++dps;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void LfgRolesSummary::Add(LfgRolesSummary const& right)
+{
+    players += right.players;
+    tanks += right.tanks;
+    healers += right.healers;
+    dps += right.dps;
+}
+
 char const* GetCompatibleString(LfgCompatibility compatibles)
 {
     switch (compatibles)
@@ -101,17 +184,13 @@ void LFGQueue::RemoveFromQueue(uint64 guid)
     RemoveFromCurrentQueue(guid);
     RemoveFromCompatibles(guid);
 
-    std::ostringstream o;
-    o << guid;
-    std::string sguid = o.str();
-
     LfgQueueDataContainer::iterator itDelete = QueueDataStore.end();
     for (LfgQueueDataContainer::iterator itr = QueueDataStore.begin(); itr != QueueDataStore.end(); ++itr)
         if (itr->first != guid)
         {
-            if (std::string::npos != itr->second.bestCompatible.find(sguid))
+            if (itr->second.bestCompatible.Contains(guid))
             {
-                itr->second.bestCompatible.clear();
+                itr->second.bestCompatible = LfgGuidKey();
                 FindBestCompatibleInQueue(itr);
             }
         }
@@ -190,60 +269,114 @@ void LFGQueue::UpdateWaitTimeDps(int32 waitTime, uint32 dungeonId)
 */
 void LFGQueue::RemoveFromCompatibles(uint64 guid)
 {
-    std::stringstream out;
-    out << guid;
-    std::string strGuid = out.str();
-
     TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::RemoveFromCompatibles: Removing [" UI64FMTD "]", guid);
-    for (LfgCompatibleContainer::iterator itNext = CompatibleMapStore.begin(); itNext != CompatibleMapStore.end();)
+
+    LfgCompatibleKeysContainer::iterator itKeys = CompatibleKeysStore.find(guid);
+    if (itKeys == CompatibleKeysStore.end())
+        return;
+
+    std::vector<uint64> hashes;
+    hashes.swap(itKeys->second);
+    CompatibleKeysStore.erase(itKeys);
+
+    for (std::vector<uint64>::const_iterator itHash = hashes.begin(); itHash != hashes.end(); ++itHash)
     {
-        LfgCompatibleContainer::iterator it = itNext++;
-        if (std::string::npos != it->first.find(strGuid))
-            CompatibleMapStore.erase(it);
+        LfgCompatibleContainer::iterator it = CompatibleMapStore.find(*itHash);
+        if (it == CompatibleMapStore.end())
+            continue;
+
+        UnlinkCompatibleEntry(*itHash, it->second.key);
+        CompatibleMapStore.erase(it);
+    }
+}
+
+/// Drops the hash of a cache entry from the lists of the guids of its key
+void LFGQueue::UnlinkCompatibleEntry(uint64 hash, LfgGuidKey const& key)
+{
+    for (uint8 i = 0; i < key.GetSize(); ++i)
+    {
+        LfgCompatibleKeysContainer::iterator itKeys = CompatibleKeysStore.find(key.guids[i]);
+        if (itKeys == CompatibleKeysStore.end())
+            continue;
+
+        std::vector<uint64>& hashes = itKeys->second;
+        std::vector<uint64>::iterator itHash = std::find(hashes.begin(), hashes.end(), hash);
+        if (itHash != hashes.end())
+        {
+            *itHash = hashes.back();
+            hashes.pop_back();
+        }
+
+        if (hashes.empty())
+            CompatibleKeysStore.erase(itKeys);
     }
 }
 
 /**
    Stores the compatibility of a list of guids
 
-   @param[in]     key String concatenation of guids (| used as separator)
+   @param[in]     key Guids of the group
    @param[in]     compatibles type of compatibility
 */
-void LFGQueue::SetCompatibles(std::string const& key, LfgCompatibility compatibles)
+void LFGQueue::SetCompatibles(LfgGuidKey const& key, LfgCompatibility compatibles)
 {
-    LfgCompatibilityData& data = CompatibleMapStore[key];
+    LfgCompatibilityData& data = GetOrCreateCompatibilityData(key);
     data.compatibility = compatibles;
 }
 
-void LFGQueue::SetCompatibilityData(std::string const& key, LfgCompatibilityData const& data)
+void LFGQueue::SetCompatibilityData(LfgGuidKey const& key, LfgCompatibilityData const& data)
 {
-    CompatibleMapStore[key] = data;
+    GetOrCreateCompatibilityData(key) = data;
 }
 
 /**
    Get the compatibility of a group of guids
 
-   @param[in]     key String concatenation of guids (| used as separator)
+   @param[in]     key Guids of the group
    @return LfgCompatibility type of compatibility
 */
-LfgCompatibility LFGQueue::GetCompatibles(std::string const& key)
+LfgCompatibility LFGQueue::GetCompatibles(LfgGuidKey const& key)
 {
-    LfgCompatibleContainer::iterator itr = CompatibleMapStore.find(key);
-    if (itr != CompatibleMapStore.end())
-        return itr->second.compatibility;
+    if (LfgCompatibilityData* data = GetCompatibilityData(key))
+        return data->compatibility;
 
     return LFG_COMPATIBILITY_PENDING;
 }
 
-LfgCompatibilityData* LFGQueue::GetCompatibilityData(std::string const& key)
+LfgCompatibilityData* LFGQueue::GetCompatibilityData(LfgGuidKey const& key)
 {
-    LfgCompatibleContainer::iterator itr = CompatibleMapStore.find(key);
-    if (itr != CompatibleMapStore.end())
-        return &(itr->second);
+    LfgCompatibleContainer::iterator itr = CompatibleMapStore.find(key.GetHash());
+    if (itr != CompatibleMapStore.end() && itr->second.key == key)
+        return &(itr->second.data);
 
     return NULL;
 }
 
+/// On a hash collision the older key is dropped, it is only a cache and gets computed again if needed
+LfgCompatibilityData& LFGQueue::GetOrCreateCompatibilityData(LfgGuidKey const& key)
+{
+    uint64 hash = key.GetHash();
+    LfgCompatibleContainer::iterator itr = CompatibleMapStore.find(hash);
+    if (itr != CompatibleMapStore.end())
+    {
+        if (itr->second.key == key)
+            return itr->second.data;
+
+        // collision, the replaced key's guids must not keep pointing at the slot
+        UnlinkCompatibleEntry(hash, itr->second.key);
+    }
+
+    LfgCompatibilityEntry& entry = CompatibleMapStore[hash];
+    entry.key = key;
+    entry.data = LfgCompatibilityData();
+
+    // each guid lists the hash once, for as long as the entry holds a key containing it
+    for (uint8 i = 0; i < key.GetSize(); ++i)
+        CompatibleKeysStore[key.guids[i]].push_back(hash);
+
+    return entry.data;
+}
+
 uint8 LFGQueue::FindGroups()
 {
     uint8 proposals = 0;
@@ -276,28 +409,52 @@ uint8 LFGQueue::FindGroups()
 */
 LfgCompatibility LFGQueue::FindNewGroups(LfgGuidList& check, LfgGuidList& all)
 {
-    std::string strGuids = ConcatenateGuids(check);
-    LfgCompatibility compatibles = GetCompatibles(strGuids);
+    if (check.size() > LFG_GUID_KEY_MAX_SIZE)
+        return LFG_INCOMPATIBLES_WRONG_GROUP_SIZE;
 
-    TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::FindNewGroup: (%s): %s - all(%s)", strGuids.c_str(), GetCompatibleString(compatibles), ConcatenateGuids(all).c_str());
+    LfgGuidKey key(check);
+    LfgCompatibility compatibles = GetCompatibles(key);
+
+    TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::FindNewGroup: (%s): %s - all(%u)", key.ToString().c_str(), GetCompatibleString(compatibles), uint32(all.size()));
     if (compatibles == LFG_COMPATIBILITY_PENDING) // Not previously cached, calculate
         compatibles = CheckCompatibility(check);
 
     if (compatibles == LFG_COMPATIBLES_BAD_STATES && sLFGMgr->AllQueued(check))
     {
-        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::FindNewGroup: (%s) compatibles (cached) changed from bad states to match", strGuids.c_str());
-        SetCompatibles(strGuids, LFG_COMPATIBLES_MATCH);
+        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::FindNewGroup: (%s) compatibles (cached) changed from bad states to match", key.ToString().c_str());
+        SetCompatibles(key, LFG_COMPATIBLES_MATCH);
         return LFG_COMPATIBLES_MATCH;
     }
 
     if (compatibles != LFG_COMPATIBLES_WITH_LESS_PLAYERS)
         return compatibles;
 
+    // players and fixed roles of the current combination, to skip queued groups that can't fit before any lookup
+    LfgRolesSummary checkSummary;
+    for (LfgGuidList::const_iterator it = check.begin(); it != check.end(); ++it)
+    {
+        LfgQueueDataContainer::const_iterator itQueue = QueueDataStore.find(*it);
+        if (itQueue != QueueDataStore.end())
+            checkSummary.Add(itQueue->second.rolesSummary);
+    }
+
     // Try to match with queued groups
     while (!all.empty())
     {
-        check.push_back(all.front());
+        uint64 candidate = all.front();
         all.pop_front();
+
+        // not queued ones are left to CheckCompatibility, it drops them from the queue
+        LfgQueueDataContainer::const_iterator itQueue = QueueDataStore.find(candidate);
+        if (itQueue != QueueDataStore.end())
+        {
+            LfgRolesSummary summary = checkSummary;
+            summary.Add(itQueue->second.rolesSummary);
+            if (!summary.CanFormGroup())
+                continue;
+        }
+
+        check.push_back(candidate);
         LfgCompatibility subcompatibility = FindNewGroups(check, all);
         if (subcompatibility == LFG_COMPATIBLES_MATCH)
             return LFG_COMPATIBLES_MATCH;
@@ -314,7 +471,6 @@ LfgCompatibility LFGQueue::FindNewGroups(LfgGuidList& check, LfgGuidList& all)
 */
 LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
 {
-    std::string strGuids = ConcatenateGuids(check);
     LfgProposal proposal;
     LfgDungeonSet proposalDungeons;
     LfgGroupsMap proposalGroups;
@@ -323,10 +479,12 @@ LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
     // Check for correct size
     if (check.size() > MAXGROUPSIZE || check.empty())
     {
-        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s): Size wrong - Not compatibles", strGuids.c_str());
+        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%u guids): Size wrong - Not compatibles", uint32(check.size()));
         return LFG_INCOMPATIBLES_WRONG_GROUP_SIZE;
     }
 
+    LfgGuidKey key(check);
+
     // Check all-but-new compatiblitity
     if (check.size() > 2)
     {
@@ -337,8 +495,8 @@ LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
         LfgCompatibility child_compatibles = CheckCompatibility(check);
         if (child_compatibles < LFG_COMPATIBLES_WITH_LESS_PLAYERS) // Group not compatible
         {
-            TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) child %s not compatibles", strGuids.c_str(), ConcatenateGuids(check).c_str());
-            SetCompatibles(strGuids, child_compatibles);
+            TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) child %s not compatibles", key.ToString().c_str(), ConcatenateGuids(check).c_str());
+            SetCompatibles(key, child_compatibles);
             return child_compatibles;
         }
         check.push_front(frontGuid);
@@ -375,29 +533,29 @@ LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
     // Group with less that MAXGROUPSIZE members always compatible
     if (check.size() == 1 && numPlayers != MAXGROUPSIZE)
     {
-        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) sigle group. Compatibles", strGuids.c_str());
+        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) sigle group. Compatibles", key.ToString().c_str());
         LfgQueueDataContainer::iterator itQueue = QueueDataStore.find(check.front());
 
         LfgCompatibilityData data(LFG_COMPATIBLES_WITH_LESS_PLAYERS);
         data.roles = itQueue->second.roles;
         LFGMgr::CheckGroupRoles(data.roles);
 
-        UpdateBestCompatibleInQueue(itQueue, strGuids, data.roles);
-        SetCompatibilityData(strGuids, data);
+        UpdateBestCompatibleInQueue(itQueue, key, data.roles);
+        SetCompatibilityData(key, data);
         return LFG_COMPATIBLES_WITH_LESS_PLAYERS;
     }
 
     if (numLfgGroups > 1)
     {
-        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) More than one Lfggroup (%u)", strGuids.c_str(), numLfgGroups);
-        SetCompatibles(strGuids, LFG_INCOMPATIBLES_MULTIPLE_LFG_GROUPS);
+        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) More than one Lfggroup (%u)", key.ToString().c_str(), numLfgGroups);
+        SetCompatibles(key, LFG_INCOMPATIBLES_MULTIPLE_LFG_GROUPS);
         return LFG_INCOMPATIBLES_MULTIPLE_LFG_GROUPS;
     }
 
     if (numPlayers > MAXGROUPSIZE)
     {
-        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) Too much players (%u)", strGuids.c_str(), numPlayers);
-        SetCompatibles(strGuids, LFG_INCOMPATIBLES_TOO_MUCH_PLAYERS);
+        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) Too much players (%u)", key.ToString().c_str(), numPlayers);
+        SetCompatibles(key, LFG_INCOMPATIBLES_TOO_MUCH_PLAYERS);
         return LFG_INCOMPATIBLES_TOO_MUCH_PLAYERS;
     }
 
@@ -424,8 +582,8 @@ LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
 
         if (uint8 playersize = numPlayers - proposalRoles.size())
         {
-            TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) not compatible, %u players are ignoring each other", strGuids.c_str(), playersize);
-            SetCompatibles(strGuids, LFG_INCOMPATIBLES_HAS_IGNORES);
+            TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) not compatible, %u players are ignoring each other", key.ToString().c_str(), playersize);
+            SetCompatibles(key, LFG_INCOMPATIBLES_HAS_IGNORES);
             return LFG_INCOMPATIBLES_HAS_IGNORES;
         }
 
@@ -436,8 +594,8 @@ LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
             for (LfgRolesMap::const_iterator it = debugRoles.begin(); it != debugRoles.end(); ++it)
                 o << ", " << it->first << ": " << GetRolesString(it->second);
 
-            TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) Roles not compatible%s", strGuids.c_str(), o.str().c_str());
-            SetCompatibles(strGuids, LFG_INCOMPATIBLES_NO_ROLES);
+            TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) Roles not compatible%s", key.ToString().c_str(), o.str().c_str());
+            SetCompatibles(key, LFG_INCOMPATIBLES_NO_ROLES);
             return LFG_INCOMPATIBLES_NO_ROLES;
         }
 
@@ -456,8 +614,8 @@ LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
 
         if (proposalDungeons.empty())
         {
-            TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) No compatible dungeons%s", strGuids.c_str(), o.str().c_str());
-            SetCompatibles(strGuids, LFG_INCOMPATIBLES_NO_DUNGEONS);
+            TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) No compatible dungeons%s", key.ToString().c_str(), o.str().c_str());
+            SetCompatibles(key, LFG_INCOMPATIBLES_NO_DUNGEONS);
             return LFG_INCOMPATIBLES_NO_DUNGEONS;
         }
     }
@@ -473,14 +631,14 @@ LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
     // Enough players?
     if (numPlayers != MAXGROUPSIZE)
     {
-        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) Compatibles but not enough players(%u)", strGuids.c_str(), numPlayers);
+        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) Compatibles but not enough players(%u)", key.ToString().c_str(), numPlayers);
         LfgCompatibilityData data(LFG_COMPATIBLES_WITH_LESS_PLAYERS);
         data.roles = proposalRoles;
 
         for (LfgGuidList::const_iterator itr = check.begin(); itr != check.end(); ++itr)
-            UpdateBestCompatibleInQueue(QueueDataStore.find(*itr), strGuids, data.roles);
+            UpdateBestCompatibleInQueue(QueueDataStore.find(*itr), key, data.roles);
 
-        SetCompatibilityData(strGuids, data);
+        SetCompatibilityData(key, data);
         return LFG_COMPATIBLES_WITH_LESS_PLAYERS;
     }
 
@@ -490,8 +648,8 @@ LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
 
     if (!sLFGMgr->AllQueued(check))
     {
-        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) Group MATCH but can't create proposal!", strGuids.c_str());
-        SetCompatibles(strGuids, LFG_COMPATIBLES_BAD_STATES);
+        TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) Group MATCH but can't create proposal!", key.ToString().c_str());
+        SetCompatibles(key, LFG_COMPATIBLES_BAD_STATES);
         return LFG_COMPATIBLES_BAD_STATES;
     }
 
@@ -532,8 +690,8 @@ LfgCompatibility LFGQueue::CheckCompatibility(LfgGuidList check)
 
     sLFGMgr->AddProposal(proposal);
 
-    TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) MATCH! Group formed", strGuids.c_str());
-    SetCompatibles(strGuids, LFG_COMPATIBLES_MATCH);
+    TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::CheckCompatibility: (%s) MATCH! Group formed", key.ToString().c_str());
+    SetCompatibles(key, LFG_COMPATIBLES_MATCH);
     return LFG_COMPATIBLES_MATCH;
 }
 
@@ -575,7 +733,7 @@ void LFGQueue::UpdateQueueTimers(time_t currTime)
                 break;
         }
 
-        if (queueinfo.bestCompatible.empty())
+        if (queueinfo.bestCompatible.IsEmpty())
             FindBestCompatibleInQueue(itQueue);
 
         LfgQueueStatusData queueData(dungeonId, waitTime, wtAvg, wtTank, wtHealer, wtDps, queuedTime, queueinfo.tanks, queueinfo.healers, queueinfo.dps);
@@ -624,7 +782,7 @@ std::string LFGQueue::DumpCompatibleInfo(bool full /* = false */) const
     o << "Compatible Map size: " << CompatibleMapStore.size() << "\n";
     if (full)
         for (LfgCompatibleContainer::const_iterator itr = CompatibleMapStore.begin(); itr != CompatibleMapStore.end(); ++itr)
-            o << "(" << itr->first << "): " << GetCompatibleString(itr->second.compatibility) << "\n";
+            o << "(" << itr->second.key.ToString() << "): " << GetCompatibleString(itr->second.data.compatibility) << "\n";
 
     return o.str();
 }
@@ -632,32 +790,31 @@ std::string LFGQueue::DumpCompatibleInfo(bool full /* = false */) const
 void LFGQueue::FindBestCompatibleInQueue(LfgQueueDataContainer::iterator itrQueue)
 {
     TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::FindBestCompatibleInQueue: " UI64FMTD, itrQueue->first);
-    std::ostringstream o;
-    o << itrQueue->first;
-    std::string sguid = o.str();
 
-    for (LfgCompatibleContainer::const_iterator itr = CompatibleMapStore.begin(); itr != CompatibleMapStore.end(); ++itr)
-        if (itr->second.compatibility == LFG_COMPATIBLES_WITH_LESS_PLAYERS &&
-            std::string::npos != itr->first.find(sguid))
+    LfgCompatibleKeysContainer::const_iterator itKeys = CompatibleKeysStore.find(itrQueue->first);
+    if (itKeys == CompatibleKeysStore.end())
+        return;
+
+    for (std::vector<uint64>::const_iterator itHash = itKeys->second.begin(); itHash != itKeys->second.end(); ++itHash)
+    {
+        LfgCompatibleContainer::const_iterator itr = CompatibleMapStore.find(*itHash);
+        if (itr != CompatibleMapStore.end() && itr->second.data.compatibility == LFG_COMPATIBLES_WITH_LESS_PLAYERS &&
+            itr->second.key.Contains(itrQueue->first))
         {
-            UpdateBestCompatibleInQueue(itrQueue, itr->first, itr->second.roles);
+            UpdateBestCompatibleInQueue(itrQueue, itr->second.key, itr->second.data.roles);
         }
+    }
 }
 
-void LFGQueue::UpdateBestCompatibleInQueue(LfgQueueDataContainer::iterator itrQueue, std::string const& key, LfgRolesMap const& roles)
+void LFGQueue::UpdateBestCompatibleInQueue(LfgQueueDataContainer::iterator itrQueue, LfgGuidKey const& key, LfgRolesMap const& roles)
 {
     LfgQueueData& queueData = itrQueue->second;
 
-    uint8 storedSize = queueData.bestCompatible.empty() ? 0 :
-        std::count(queueData.bestCompatible.begin(), queueData.bestCompatible.end(), '|') + 1;
-
-    uint8 size = std::count(key.begin(), key.end(), '|') + 1;
-
-    if (size <= storedSize)
+    if (key.GetSize() <= queueData.bestCompatible.GetSize())
         return;
 
     TC_LOG_DEBUG(LOG_FILTER_LFG, "LFGQueue::UpdateBestCompatibleInQueue: Changed (%s) to (%s) as best compatible group for " UI64FMTD,
-        queueData.bestCompatible.c_str(), key.c_str(), itrQueue->first);
+        queueData.bestCompatible.ToString().c_str(), key.ToString().c_str(), itrQueue->first);
 
     queueData.bestCompatible = key;
     queueData.tanks = LFG_TANKS_NEEDED;
@@ -19,10 +19,13 @@
 #define _LFGQUEUE_H
 
 #include "LFG.h"
+#include "UnorderedMap.h"
 
 namespace lfg
 {
 
+#define LFG_GUID_KEY_MAX_SIZE (LFG_TANKS_NEEDED + LFG_HEALERS_NEEDED + LFG_DPS_NEEDED)
+
 enum LfgCompatibility
 {
     LFG_COMPATIBILITY_PENDING,
@@ -37,6 +40,45 @@ enum LfgCompatibility
     LFG_COMPATIBLES_MATCH                                  // Must be the last one
 };
 
+/// Sorted, duplicate free set of the queue guids of one candidate group, used as compatibility cache key
+struct LfgGuidKey
+{
+    LfgGuidKey(): size(0) { }
+    explicit LfgGuidKey(LfgGuidList const& check);
+
+    bool IsEmpty() const { return !size; }
+    uint8 GetSize() const { return size; }
+    bool Contains(uint64 guid) const;
+    uint64 GetHash() const;
+    std::string ToString() const;
+
+    bool operator==(LfgGuidKey const& right) const;
+    bool operator!=(LfgGuidKey const& right) const { return !(*this == right); }
+
+    uint64 guids[LFG_GUID_KEY_MAX_SIZE];
+    uint8 size;
+};
+
+/// Players of a queue entry and how many of them can only fill one role
+struct LfgRolesSummary
+{
+    LfgRolesSummary(): players(0), tanks(0), healers(0), dps(0) { }
+
+    void Add(LfgRolesMap const& roles);
+    void Add(LfgRolesSummary const& right);
+
+    /// Cheap necessary condition for LFGMgr::CheckGroupRoles, false means the players can never form one group
+    bool CanFormGroup() const
+    {
+        return players <= LFG_GUID_KEY_MAX_SIZE && tanks <= LFG_TANKS_NEEDED && healers <= LFG_HEALERS_NEEDED && dps <= LFG_DPS_NEEDED;
+    }
+
+    uint8 players;
+    uint8 tanks;
+    uint8 healers;
+    uint8 dps;
+};
+
 struct LfgCompatibilityData
 {
     LfgCompatibilityData(): compatibility(LFG_COMPATIBILITY_PENDING) { }
@@ -48,6 +90,12 @@ struct LfgCompatibilityData
     LfgRolesMap roles;
 };
 
+struct LfgCompatibilityEntry
+{
+    LfgGuidKey key;
+    LfgCompatibilityData data;
+};
+
 /// Stores player or group queue info
 struct LfgQueueData
 {
@@ -58,7 +106,7 @@ struct LfgQueueData
     LfgQueueData(time_t _joinTime, LfgDungeonSet const& _dungeons, LfgRolesMap const& _roles):
         joinTime(_joinTime), tanks(LFG_TANKS_NEEDED), healers(LFG_HEALERS_NEEDED),
         dps(LFG_DPS_NEEDED), dungeons(_dungeons), roles(_roles)
-        { }
+        { rolesSummary.Add(_roles); }
 
     time_t joinTime;                                       ///< Player queue join time (to calculate wait times)
     uint8 tanks;                                           ///< Tanks needed
@@ -66,7 +114,8 @@ struct LfgQueueData
     uint8 dps;                                             ///< Dps needed
     LfgDungeonSet dungeons;                                ///< Selected Player/Group Dungeon/s
     LfgRolesMap roles;                                     ///< Selected Player Role/s
-    std::string bestCompatible;                            ///< Best compatible combination of people queued
+    LfgRolesSummary rolesSummary;                          ///< Player and fixed role count of roles
+    LfgGuidKey bestCompatible;                             ///< Best compatible combination of people queued
 };
 
 struct LfgWaitTime
@@ -77,7 +126,8 @@ struct LfgWaitTime
 };
 
 typedef std::map<uint32, LfgWaitTime> LfgWaitTimesContainer;
-typedef std::map<std::string, LfgCompatibilityData> LfgCompatibleContainer;
+typedef UNORDERED_MAP<uint64, LfgCompatibilityEntry> LfgCompatibleContainer;   ///< LfgGuidKey::GetHash() -> entry
+typedef UNORDERED_MAP<uint64, std::vector<uint64> > LfgCompatibleKeysContainer; ///< guid -> hashes of the cache entries whose key contains it
 typedef std::map<uint64, LfgQueueData> LfgQueueDataContainer;
 
 /**
@@ -119,14 +169,16 @@ class LFGQueue
         void RemoveFromNewQueue(uint64 guid);
         void RemoveFromCurrentQueue(uint64 guid);
 
-        void SetCompatibles(std::string const& key, LfgCompatibility compatibles);
-        LfgCompatibility GetCompatibles(std::string const& key);
+        void SetCompatibles(LfgGuidKey const& key, LfgCompatibility compatibles);
+        LfgCompatibility GetCompatibles(LfgGuidKey const& key);
         void RemoveFromCompatibles(uint64 guid);
 
-        void SetCompatibilityData(std::string const& key, LfgCompatibilityData const& compatibles);
-        LfgCompatibilityData* GetCompatibilityData(std::string const& key);
+        void SetCompatibilityData(LfgGuidKey const& key, LfgCompatibilityData const& compatibles);
+        LfgCompatibilityData* GetCompatibilityData(LfgGuidKey const& key);
+        LfgCompatibilityData& GetOrCreateCompatibilityData(LfgGuidKey const& key);
+        void UnlinkCompatibleEntry(uint64 hash, LfgGuidKey const& key);
         void FindBestCompatibleInQueue(LfgQueueDataContainer::iterator itrQueue);
-        void UpdateBestCompatibleInQueue(LfgQueueDataContainer::iterator itrQueue, std::string const& key, LfgRolesMap const& roles);
+        void UpdateBestCompatibleInQueue(LfgQueueDataContainer::iterator itrQueue, LfgGuidKey const& key, LfgRolesMap const& roles);
 
         LfgCompatibility FindNewGroups(LfgGuidList& check, LfgGuidList& all);
         LfgCompatibility CheckCompatibility(LfgGuidList check);
@@ -134,6 +186,7 @@ class LFGQueue
         // Queue
         LfgQueueDataContainer QueueDataStore;              ///< Queued groups
         LfgCompatibleContainer CompatibleMapStore;         ///< Compatible dungeons
+        LfgCompatibleKeysContainer CompatibleKeysStore;    ///< Cache entries each queued guid is part of
 
         LfgWaitTimesContainer waitTimesAvgStore;           ///< Average wait time to find a group queuing as multiple roles
         LfgWaitTimesContainer waitTimesTankStore;          ///< Average wait time to find a group queuing as tank
@@ -147,7 +147,8 @@ m_PlayerDamageReq(0), m_lootRecipient(0), m_lootRecipientGroup(0), m_corpseRemov
 m_respawnDelay(300), m_corpseDelay(60), m_respawnradius(0.0f), m_reactState(REACT_AGGRESSIVE),
 m_defaultMovementType(IDLE_MOTION_TYPE), m_DBTableGuid(0), m_equipmentId(0), m_originalEquipmentId(0), m_AlreadyCallAssistance(false),
 m_AlreadySearchedAssistance(false), m_regenHealth(true), m_AI_locked(false), m_meleeDamageSchoolMask(SPELL_SCHOOL_MASK_NORMAL),
-m_creatureInfo(NULL), m_creatureData(NULL), m_path_id(0), m_formation(NULL)
+m_creatureInfo(NULL), m_creatureData(NULL), m_path_id(0), m_formation(NULL),
+m_terrainProbeGroundZ(INVALID_HEIGHT), m_terrainProbeInWater(false), m_terrainProbeValid(false)
 {
     m_regenTimer = CREATURE_REGEN_INTERVAL;
     m_valuesCount = UNIT_END;
@@ -200,6 +201,7 @@ void Creature::RemoveFromWorld()
             m_zoneScript->OnCreatureRemove(this);
         if (m_formation)
             sFormationMgr->RemoveCreatureFromGroup(m_formation, this);
+        m_terrainProbeValid = false;
         Unit::RemoveFromWorld();
         sObjectAccessor->RemoveObject(this);
     }
@@ -436,6 +438,8 @@ bool Creature::UpdateEntry(uint32 Entry, uint32 team, const CreatureData* data)
         ApplySpellImmune(0, IMMUNITY_EFFECT, SPELL_EFFECT_ATTACK_ME, true);
     }
 
+    // the inhabit type may have changed
+    m_terrainProbeValid = false;
     UpdateMovementFlags();
     return true;
 }
@@ -2530,10 +2534,21 @@ Unit* Creature::SelectNearestHostileUnitInAggroRange(bool useLOS) const
 
 void Creature::UpdateMovementFlags()
 {
+    // the terrain probes include vmap raycasts, redo them only once the creature really moved
+    float z = GetPositionZMinusOffset();
+    if (!m_terrainProbeValid || GetExactDist2dSq(&m_terrainProbePos) > CREATURE_TERRAIN_PROBE_DIST * CREATURE_TERRAIN_PROBE_DIST ||
+        fabs(z - m_terrainProbePos.GetPositionZ()) > CREATURE_TERRAIN_PROBE_DIST)
+    {
+        m_terrainProbePos.Relocate(GetPositionX(), GetPositionY(), z);
+        m_terrainProbeGroundZ = GetMap()->GetHeight(GetPositionX(), GetPositionY(), z);
+        m_terrainProbeInWater = (GetCreatureTemplate()->InhabitType & INHABIT_WATER) && IsInWater();
+        m_terrainProbeValid = true;
+    }
+
     // Set the movement flags if the creature is in that mode. (Only fly if actually in air, only swim if in water, etc)
-    float ground = GetMap()->GetHeight(GetPositionX(), GetPositionY(), GetPositionZMinusOffset());
+    float ground = m_terrainProbeGroundZ;
 
-    bool isInAir = !IsFalling() && (G3D::fuzzyGt(GetPositionZMinusOffset(), ground + 0.05f) || G3D::fuzzyLt(GetPositionZMinusOffset(), ground - 0.05f)); // Can be underground too, prevent the falling
+    bool isInAir = !IsFalling() && (G3D::fuzzyGt(z, ground + 0.05f) || G3D::fuzzyLt(z, ground - 0.05f)); // Can be underground too, prevent the falling
 
     if (GetCreatureTemplate()->InhabitType & INHABIT_AIR && isInAir)
     {
@@ -2548,7 +2563,7 @@ void Creature::UpdateMovementFlags()
         SetDisableGravity(false);
     }
 
-    if (GetCreatureTemplate()->InhabitType & INHABIT_WATER && IsInWater())
+    if (m_terrainProbeInWater)
         AddUnitMovementFlag(MOVEMENTFLAG_SWIMMING);
     else
         RemoveUnitMovementFlag(MOVEMENTFLAG_SWIMMING);
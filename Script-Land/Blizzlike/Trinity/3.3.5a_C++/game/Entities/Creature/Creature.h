@@ -413,6 +413,9 @@ typedef std::map<uint32, time_t> CreatureSpellCooldowns;
 // max different by z coordinate for creature aggro reaction
 #define CREATURE_Z_ATTACK_RANGE 3
 
+// moves below this (yards, also along z) keep the cached terrain probe of UpdateMovementFlags
+#define CREATURE_TERRAIN_PROBE_DIST 0.05f
+
 #define MAX_VENDOR_ITEMS 150                                // Limitation in 3.x.x item count in SMSG_LIST_INVENTORY
 
 enum CreatureCellMoveState
@@ -758,6 +761,12 @@ class Creature : public Unit, public GridObject<Creature>, public MapCreature
         //Formation var
         CreatureGroup* m_formation;
         bool TriggerJustRespawned;
+
+        // ground height and water state at m_terrainProbePos, static terrain only
+        Position m_terrainProbePos;
+        float m_terrainProbeGroundZ;
+        bool m_terrainProbeInWater;
+        bool m_terrainProbeValid;
 };
 
 class AssistDelayEvent : public BasicEvent
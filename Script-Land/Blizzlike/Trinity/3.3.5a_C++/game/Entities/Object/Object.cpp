@@ -51,6 +51,60 @@
 #include "Battlefield.h"
 #include "BattlefieldMgr.h"
 
+/// Fields of an update field flags table carrying each UF_FLAG_* bit, built once
+/// so that visibility filtering of update masks works on whole mask blocks
+class UpdateFieldFlagMasks
+{
+    public:
+        enum { UF_FLAG_BITS = 9 };
+
+        UpdateFieldFlagMasks(uint32 const* flags, uint32 count) : _flags(flags)
+        {
+            for (uint32 bit = 0; bit < UF_FLAG_BITS; ++bit)
+                _masks[bit].SetCount(count);
+
+            for (uint32 index = 0; index < count; ++index)
+                for (uint32 bit = 0; bit < UF_FLAG_BITS; ++bit)
+                    if (flags[index] & (1 << bit))
+                        _masks[bit].SetBit(index);
+        }
+
+        uint32 const* GetFlags() const { return _flags; }
+
+        /// Sets in mask all fields carrying any of the given flags
+        void Apply(UpdateMask& mask, uint32 flags) const
+        {
+            for (uint32 bit = 0; bit < UF_FLAG_BITS; ++bit)
+                if (flags & (1 << bit))
+                    for (uint32 block = 0; block < mask.GetBlockCount(); ++block)
+                        mask.SetBlock(block, mask.GetBlock(block) | _masks[bit].GetBlock(block));
+
+            mask.TrimToCount();
+        }
+
+    private:
+        uint32 const* _flags;
+        UpdateMask _masks[UF_FLAG_BITS];
+};
+
+static UpdateFieldFlagMasks const UpdateFieldFlagMasksByType[] =
+{
+    UpdateFieldFlagMasks(ItemUpdateFieldFlags, CONTAINER_END),
+    UpdateFieldFlagMasks(UnitUpdateFieldFlags, PLAYER_END),
+    UpdateFieldFlagMasks(GameObjectUpdateFieldFlags, GAMEOBJECT_END),
+    UpdateFieldFlagMasks(DynamicObjectUpdateFieldFlags, DYNAMICOBJECT_END),
+    UpdateFieldFlagMasks(CorpseUpdateFieldFlags, CORPSE_END)
+};
+
+static UpdateFieldFlagMasks const* GetUpdateFieldFlagMasks(uint32 const* flags)
+{
+    for (uint8 i = 0; i < sizeof(UpdateFieldFlagMasksByType) / sizeof(UpdateFieldFlagMasksByType[0]); ++i)
+        if (UpdateFieldFlagMasksByType[i].GetFlags() == flags)
+            return &UpdateFieldFlagMasksByType[i];
+
+    return NULL;
+}
+
 uint32 GuidHigh2TypeId(uint32 guid_hi)
 {
     switch (guid_hi)
@@ -256,8 +310,7 @@ void Object::BuildCreateUpdateBlockForPlayer(UpdateData* data, Player* target) c
 
     _BuildMovementUpdate(&buf, flags);
 
-    UpdateMask updateMask;
-    updateMask.SetCount(m_valuesCount);
+    UpdateMask updateMask(m_valuesCount);
     _SetCreateBits(&updateMask, target);
     _BuildValuesUpdate(updateType, &buf, &updateMask, target);
     data->AddUpdateBlock(buf);
@@ -274,20 +327,100 @@ void Object::SendUpdateToPlayer(Player* player)
     player->GetSession()->SendPacket(&packet);
 }
 
-void Object::BuildValuesUpdateBlockForPlayer(UpdateData* data, Player* target) const
+void Object::BuildValuesUpdateBlockForPlayer(UpdateData* data, Player* target, UpdateBlockCache* blockCache) const
 {
+    UpdateMask updateMask(m_valuesCount);
+    uint32 visibleFlag = _SetUpdateBits(&updateMask, target);
+
+    // observers of the same visibility class get the same bytes, only the per target fields are rewritten
+    if (blockCache)
+    {
+        if (UpdateBlockCacheEntry const* entry = blockCache->Find(visibleFlag))
+        {
+            _AppendSharedValuesUpdate(data, *entry, target);
+            return;
+        }
+    }
+
     ByteBuffer buf(500);
 
     buf << uint8(UPDATETYPE_VALUES);
     buf.append(GetPackGUID());
 
-    UpdateMask updateMask;
-    updateMask.SetCount(m_valuesCount);
-
-    _SetUpdateBits(&updateMask, target);
+    size_t maskPos = buf.wpos();
     _BuildValuesUpdate(UPDATETYPE_VALUES, &buf, &updateMask, target);
 
     data->AddUpdateBlock(buf);
+
+    if (!blockCache)
+        return;
+
+    // _BuildValuesUpdate may have added bits, updateMask now matches the block:
+    // block count, mask blocks, then one word per set bit
+    UpdateBlockCacheEntry& entry = blockCache->Add(visibleFlag, buf);
+    uint32 offset = uint32(maskPos + 1 + updateMask.GetBlockCount() * sizeof(UpdateMask::ClientUpdateMaskType));
+    for (uint32 index = updateMask.FindNextSetBit(0); index < m_valuesCount; index = updateMask.FindNextSetBit(index + 1), offset += 4)
+        if (IsValuesUpdateTargetField(uint16(index)))
+            entry.PatchSlots.push_back(std::make_pair(uint16(index), offset));
+}
+
+bool Object::IsValuesUpdateTargetField(uint16 index) const
+{
+    // fields _BuildValuesUpdate may write differently for each target
+    if (isType(TYPEMASK_UNIT))
+    {
+        switch (index)
+        {
+            case UNIT_NPC_FLAGS:
+            case UNIT_FIELD_AURASTATE:
+            case UNIT_FIELD_FLAGS:
+            case UNIT_FIELD_DISPLAYID:
+            case UNIT_DYNAMIC_FLAGS:
+            case UNIT_FIELD_BYTES_2:
+            case UNIT_FIELD_FACTIONTEMPLATE:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    if (GetTypeId() == TYPEID_GAMEOBJECT)
+        return index == GAMEOBJECT_DYNAMIC || index == GAMEOBJECT_FLAGS;
+
+    return false;
+}
+
+void Object::_AppendSharedValuesUpdate(UpdateData* data, UpdateBlockCacheEntry const& entry, Player* target) const
+{
+    if (entry.PatchSlots.empty())
+    {
+        data->AddUpdateBlock(entry.Block);
+        return;
+    }
+
+    // serialize only the per target fields for this target, _BuildValuesUpdate
+    // may set a few more bits, which are skipped below
+    UpdateMask patchMask(m_valuesCount);
+    for (UpdateBlockCacheEntry::PatchSlotList::const_iterator itr = entry.PatchSlots.begin(); itr != entry.PatchSlots.end(); ++itr)
+        patchMask.SetBit(itr->first);
+
+    ByteBuffer buf(64);
+    _BuildValuesUpdate(UPDATETYPE_VALUES, &buf, &patchMask, target);
+
+    UpdateBlockPatchList patches;
+    patches.reserve(entry.PatchSlots.size());
+    UpdateBlockCacheEntry::PatchSlotList::const_iterator slot = entry.PatchSlots.begin();
+    size_t pos = 1 + patchMask.GetBlockCount() * sizeof(UpdateMask::ClientUpdateMaskType);
+    for (uint32 index = patchMask.FindNextSetBit(0); index < m_valuesCount && slot != entry.PatchSlots.end(); index = patchMask.FindNextSetBit(index + 1), pos += 4)
+    {
+        if (index != slot->first)
+            continue;
+
+        patches.push_back(std::make_pair(slot->second, buf.read<uint32>(pos)));
+        ++slot;
+    }
+
+    data->AddUpdateBlock(entry.Block, patches);
 }
 
 void Object::BuildOutOfRangeUpdateBlock(UpdateData* data) const
@@ -566,7 +699,7 @@ void Object::_BuildValuesUpdate(uint8 updateType, ByteBuffer* data, UpdateMask*
     if (unit)                               // unit (creature/player) case
     {
         Creature const* creature = ToCreature();
-        for (uint16 index = 0; index < m_valuesCount; ++index)
+        for (uint16 index = updateMask->FindNextSetBit(0); index < m_valuesCount; index = updateMask->FindNextSetBit(index + 1))
         {
             if (updateMask->GetBit(index))
             {
@@ -722,7 +855,7 @@ void Object::_BuildValuesUpdate(uint8 updateType, ByteBuffer* data, UpdateMask*
     }
     else if (go)                    // gameobject case
     {
-        for (uint16 index = 0; index < m_valuesCount; ++index)
+        for (uint16 index = updateMask->FindNextSetBit(0); index < m_valuesCount; index = updateMask->FindNextSetBit(index + 1))
         {
             if (updateMask->GetBit(index))
             {
@@ -784,7 +917,7 @@ void Object::_BuildValuesUpdate(uint8 updateType, ByteBuffer* data, UpdateMask*
     }
     else                                                    // other objects case (no special index checks)
     {
-        for (uint16 index = 0; index < m_valuesCount; ++index)
+        for (uint16 index = updateMask->FindNextSetBit(0); index < m_valuesCount; index = updateMask->FindNextSetBit(index + 1))
         {
             if (updateMask->GetBit(index))
             {
@@ -802,12 +935,31 @@ void Object::ClearUpdateMask(bool remove)
     if (m_objectUpdated)
     {
         if (remove)
-            sObjectAccessor->RemoveUpdateObject(this);
+            RemoveFromObjectUpdate();
         m_objectUpdated = false;
     }
 }
 
-void Object::BuildFieldsUpdate(Player* player, UpdateDataMapType& data_map) const
+void Object::AddToObjectUpdateIfNeeded()
+{
+    if (m_inWorld && !m_objectUpdated)
+    {
+        AddToObjectUpdate();
+        m_objectUpdated = true;
+    }
+}
+
+void Object::AddToObjectUpdate()
+{
+    sObjectAccessor->AddUpdateObject(this);
+}
+
+void Object::RemoveFromObjectUpdate()
+{
+    sObjectAccessor->RemoveUpdateObject(this);
+}
+
+void Object::BuildFieldsUpdate(Player* player, UpdateDataMapType& data_map, UpdateBlockCache* blockCache) const
 {
     UpdateDataMapType::iterator iter = data_map.find(player);
 
@@ -818,7 +970,7 @@ void Object::BuildFieldsUpdate(Player* player, UpdateDataMapType& data_map) cons
         iter = p.first;
     }
 
-    BuildValuesUpdateBlockForPlayer(&iter->second, iter->first);
+    BuildValuesUpdateBlockForPlayer(&iter->second, iter->first, blockCache);
 }
 
 uint32 Object::GetUpdateFieldData(Player const* target, uint32*& flags) const
@@ -891,25 +1043,50 @@ void Object::_LoadIntoDataField(std::string const& data, uint32 startOffset, uin
     }
 }
 
-void Object::_SetUpdateBits(UpdateMask* updateMask, Player* target) const
+uint32 Object::_SetUpdateBits(UpdateMask* updateMask, Player* target) const
 {
     uint32* flags = NULL;
     uint32 visibleFlag = GetUpdateFieldData(target, flags);
+    UpdateFieldFlagMasks const* flagMasks = GetUpdateFieldFlagMasks(flags);
+    ASSERT(flagMasks);
 
-    for (uint16 index = 0; index < m_valuesCount; ++index)
-        if (_fieldNotifyFlags & flags[index] || ((flags[index] & visibleFlag) & UF_FLAG_SPECIAL_INFO) || (_changesMask.GetBit(index) && (flags[index] & visibleFlag)))
-            updateMask->SetBit(index);
+    // changed fields visible to target
+    flagMasks->Apply(*updateMask, visibleFlag);
+    *updateMask &= _changesMask;
+
+    // fields sent regardless of changes
+    flagMasks->Apply(*updateMask, _fieldNotifyFlags | (visibleFlag & UF_FLAG_SPECIAL_INFO));
+
+    return visibleFlag;
 }
 
 void Object::_SetCreateBits(UpdateMask* updateMask, Player* target) const
 {
-    uint32* value = m_uint32Values;
     uint32* flags = NULL;
     uint32 visibleFlag = GetUpdateFieldData(target, flags);
+    UpdateFieldFlagMasks const* flagMasks = GetUpdateFieldFlagMasks(flags);
+    ASSERT(flagMasks);
 
-    for (uint16 index = 0; index < m_valuesCount; ++index, ++value)
-        if (_fieldNotifyFlags & flags[index] || ((flags[index] & visibleFlag) & UF_FLAG_SPECIAL_INFO) || (*value && (flags[index] & visibleFlag)))
-            updateMask->SetBit(index);
+    // non zero fields visible to target
+    flagMasks->Apply(*updateMask, visibleFlag);
+    for (uint32 block = 0; block < updateMask->GetBlockCount(); ++block)
+    {
+        UpdateMask::ClientUpdateMaskType visible = updateMask->GetBlock(block);
+        if (!visible)
+            continue;
+
+        UpdateMask::ClientUpdateMaskType nonZero = 0;
+        uint32 first = block * UpdateMask::CLIENT_UPDATE_MASK_BITS;
+        uint32 last = std::min<uint32>(first + UpdateMask::CLIENT_UPDATE_MASK_BITS, m_valuesCount);
+        for (uint32 index = first; index < last; ++index)
+            if (m_uint32Values[index])
+                nonZero |= UpdateMask::ClientUpdateMaskType(1) << (index - first);
+
+        updateMask->SetBlock(block, visible & nonZero);
+    }
+
+    // fields sent regardless of their value
+    flagMasks->Apply(*updateMask, _fieldNotifyFlags | (visibleFlag & UF_FLAG_SPECIAL_INFO));
 }
 
 void Object::SetInt32Value(uint16 index, int32 value)
@@ -921,11 +1098,7 @@ void Object::SetInt32Value(uint16 index, int32 value)
         m_int32Values[index] = value;
         _changesMask.SetBit(index);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -938,11 +1111,7 @@ void Object::SetUInt32Value(uint16 index, uint32 value)
         m_uint32Values[index] = value;
         _changesMask.SetBit(index);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -964,11 +1133,7 @@ void Object::SetUInt64Value(uint16 index, uint64 value)
         _changesMask.SetBit(index);
         _changesMask.SetBit(index + 1);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -982,11 +1147,7 @@ bool Object::AddUInt64Value(uint16 index, uint64 value)
         _changesMask.SetBit(index);
         _changesMask.SetBit(index + 1);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
 
         return true;
     }
@@ -1004,11 +1165,7 @@ bool Object::RemoveUInt64Value(uint16 index, uint64 value)
         _changesMask.SetBit(index);
         _changesMask.SetBit(index + 1);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
 
         return true;
     }
@@ -1025,11 +1182,7 @@ void Object::SetFloatValue(uint16 index, float value)
         m_floatValues[index] = value;
         _changesMask.SetBit(index);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -1049,11 +1202,7 @@ void Object::SetByteValue(uint16 index, uint8 offset, uint8 value)
         m_uint32Values[index] |= uint32(uint32(value) << (offset * 8));
         _changesMask.SetBit(index);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -1073,11 +1222,7 @@ void Object::SetUInt16Value(uint16 index, uint8 offset, uint16 value)
         m_uint32Values[index] |= uint32(uint32(value) << (offset * 16));
         _changesMask.SetBit(index);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -1147,11 +1292,7 @@ void Object::SetFlag(uint16 index, uint32 newFlag)
         m_uint32Values[index] = newval;
         _changesMask.SetBit(index);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -1168,11 +1309,7 @@ void Object::RemoveFlag(uint16 index, uint32 oldFlag)
         m_uint32Values[index] = newval;
         _changesMask.SetBit(index);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -1212,11 +1349,7 @@ void Object::SetByteFlag(uint16 index, uint8 offset, uint8 newFlag)
         m_uint32Values[index] |= uint32(uint32(newFlag) << (offset * 8));
         _changesMask.SetBit(index);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -1235,11 +1368,7 @@ void Object::RemoveByteFlag(uint16 index, uint8 offset, uint8 oldFlag)
         m_uint32Values[index] &= ~uint32(uint32(oldFlag) << (offset * 8));
         _changesMask.SetBit(index);
 
-        if (m_inWorld && !m_objectUpdated)
-        {
-            sObjectAccessor->AddUpdateObject(this);
-            m_objectUpdated = true;
-        }
+        AddToObjectUpdateIfNeeded();
     }
 }
 
@@ -2170,11 +2299,7 @@ void WorldObject::SendPlaySound(uint32 Sound, bool OnlySelf)
 void Object::ForceValuesUpdateAtIndex(uint32 i)
 {
     _changesMask.SetBit(i);
-    if (m_inWorld && !m_objectUpdated)
-    {
-        sObjectAccessor->AddUpdateObject(this);
-        m_objectUpdated = true;
-    }
+    AddToObjectUpdateIfNeeded();
 }
 
 namespace Trinity
@@ -3153,6 +3278,7 @@ struct WorldObjectChangeAccumulator
     UpdateDataMapType& i_updateDatas;
     WorldObject& i_object;
     std::set<uint64> plr_list;
+    UpdateBlockCache i_blockCache;
     WorldObjectChangeAccumulator(WorldObject &obj, UpdateDataMapType &d) : i_updateDatas(d), i_object(obj) {}
     void Visit(PlayerMapType &m)
     {
@@ -3210,7 +3336,7 @@ struct WorldObjectChangeAccumulator
         // Only send update once to a player
         if (plr_list.find(player->GetGUID()) == plr_list.end() && player->HaveAtClient(&i_object))
         {
-            i_object.BuildFieldsUpdate(player, i_updateDatas);
+            i_object.BuildFieldsUpdate(player, i_updateDatas, &i_blockCache);
             plr_list.insert(player->GetGUID());
         }
     }
@@ -3218,6 +3344,23 @@ struct WorldObjectChangeAccumulator
     template<class SKIP> void Visit(GridRefManager<SKIP> &) {}
 };
 
+void WorldObject::AddToObjectUpdate()
+{
+    // corpses may be in world before they are bound to a map
+    if (m_currMap)
+        m_currMap->AddUpdateObject(this);
+    else
+        Object::AddToObjectUpdate();
+}
+
+void WorldObject::RemoveFromObjectUpdate()
+{
+    if (m_currMap)
+        m_currMap->RemoveUpdateObject(this);
+
+    Object::RemoveFromObjectUpdate();
+}
+
 void WorldObject::BuildUpdate(UpdateDataMapType& data_map)
 {
     CellCoord p = Trinity::ComputeCellCoord(GetPositionX(), GetPositionY());
@@ -110,6 +110,8 @@ class TempSummon;
 class Transport;
 class Unit;
 class UpdateData;
+class UpdateBlockCache;
+struct UpdateBlockCacheEntry;
 class WorldObject;
 class WorldPacket;
 class ZoneScript;
@@ -142,7 +144,7 @@ class Object
         virtual void BuildCreateUpdateBlockForPlayer(UpdateData* data, Player* target) const;
         void SendUpdateToPlayer(Player* player);
 
-        void BuildValuesUpdateBlockForPlayer(UpdateData* data, Player* target) const;
+        void BuildValuesUpdateBlockForPlayer(UpdateData* data, Player* target, UpdateBlockCache* blockCache = NULL) const;
         void BuildOutOfRangeUpdateBlock(UpdateData* data) const;
         void BuildMovementUpdateBlock(UpdateData* data, uint32 flags = 0) const;
 
@@ -200,7 +202,7 @@ class Object
         virtual bool hasQuest(uint32 /* quest_id */) const { return false; }
         virtual bool hasInvolvedQuest(uint32 /* quest_id */) const { return false; }
         virtual void BuildUpdate(UpdateDataMapType&) {}
-        void BuildFieldsUpdate(Player*, UpdateDataMapType &) const;
+        void BuildFieldsUpdate(Player*, UpdateDataMapType &, UpdateBlockCache* blockCache = NULL) const;
 
         void SetFieldNotifyFlag(uint16 flag) { _fieldNotifyFlags |= flag; }
         void RemoveFieldNotifyFlag(uint16 flag) { _fieldNotifyFlags &= ~flag; }
@@ -208,6 +210,14 @@ class Object
         // FG: some hacky helpers
         void ForceValuesUpdateAtIndex(uint32);
 
+    protected:
+        // queue holding the object until its changes are sent, see Map::SendObjectUpdates
+        virtual void AddToObjectUpdate();
+        virtual void RemoveFromObjectUpdate();
+
+        void AddToObjectUpdateIfNeeded();
+    public:
+
         Player* ToPlayer() { if (GetTypeId() == TYPEID_PLAYER) return reinterpret_cast<Player*>(this); else return NULL; }
         Player const* ToPlayer() const { if (GetTypeId() == TYPEID_PLAYER) return reinterpret_cast<Player const*>(this); else return NULL; }
 
@@ -236,7 +246,10 @@ class Object
 
         uint32 GetUpdateFieldData(Player const* target, uint32*& flags) const;
 
-        void _SetUpdateBits(UpdateMask* updateMask, Player* target) const;
+        // returns the UF_FLAG_* visibility class of target
+        uint32 _SetUpdateBits(UpdateMask* updateMask, Player* target) const;
+        bool IsValuesUpdateTargetField(uint16 index) const;
+        void _AppendSharedValuesUpdate(UpdateData* data, UpdateBlockCacheEntry const& entry, Player* target) const;
         void _SetCreateBits(UpdateMask* updateMask, Player* target) const;
         void _BuildMovementUpdate(ByteBuffer * data, uint16 flags) const;
         void _BuildValuesUpdate(uint8 updatetype, ByteBuffer *data, UpdateMask* updateMask, Player* target) const;
@@ -652,6 +665,11 @@ class WorldObject : public Object, public WorldLocation
         virtual void UpdateObjectVisibility(bool forced = true);
         void BuildUpdate(UpdateDataMapType&);
 
+    protected:
+        void AddToObjectUpdate();
+        void RemoveFromObjectUpdate();
+    public:
+
         //relocation and visibility system functions
         void AddToNotify(uint16 f) { m_notifyflags |= f;}
         bool isNeedNotify(uint16 f) const { return m_notifyflags & f;}
@@ -25,6 +25,8 @@
 #include "World.h"
 #include "zlib.h"
 
+#include <ace/TSS_T.h>
+
 UpdateData::UpdateData() : m_blockCount(0)
 {
 }
@@ -45,104 +47,232 @@ void UpdateData::AddUpdateBlock(const ByteBuffer &block)
     ++m_blockCount;
 }
 
-void UpdateData::Compress(void* dst, uint32 *dst_size, void* src, int src_size)
+void UpdateData::AddUpdateBlock(const ByteBuffer &block, UpdateBlockPatchList const& patches)
 {
-    z_stream c_stream;
+    size_t start = m_data.size();
+    m_data.append(block);
 
-    c_stream.zalloc = (alloc_func)0;
-    c_stream.zfree = (free_func)0;
-    c_stream.opaque = (voidpf)0;
+    for (UpdateBlockPatchList::const_iterator itr = patches.begin(); itr != patches.end(); ++itr)
+        m_data.put<uint32>(start + itr->first, itr->second);
 
-    // default Z_BEST_SPEED (1)
-    int z_res = deflateInit(&c_stream, sWorld->getIntConfig(CONFIG_COMPRESSION));
-    if (z_res != Z_OK)
-    {
-        TC_LOG_ERROR(LOG_FILTER_GENERAL, "Can't compress update packet (zlib: deflateInit) Error code: %i (%s)", z_res, zError(z_res));
-        *dst_size = 0;
-        return;
-    }
+    ++m_blockCount;
+}
+
+// packets up to this size are always sent uncompressed
+#define UPDATE_COMPRESS_MIN_SIZE        100
+// packets below this size are skipped while such packets recently compressed poorly
+#define UPDATE_COMPRESS_PROBE_SIZE      1024
+// compressed/raw ratio above which small packets are not worth the CPU
+#define UPDATE_COMPRESS_POOR_RATIO      0.9f
+// one skipped small packet out of this many is compressed anyway to refresh the ratio
+#define UPDATE_COMPRESS_PROBE_INTERVAL  32
+// packets above this size (logins, zone-ins) use the fastest level, these are mostly
+// repeated create blocks and level 1 already gets nearly all of the gain on them
+#define UPDATE_COMPRESS_FAST_SIZE       (32 * 1024)
+
+/**
+ * Deflate context owned by one thread.
+ *
+ * The stream is initialized once and reset with deflateReset for every packet,
+ * update packets are built on the map update threads so every thread compresses
+ * with its own context, without locking. Also keeps the compression ratio observed
+ * on small packets of this thread for the adaptive skip policy.
+ */
+class UpdateDataDeflater
+{
+    public:
+        UpdateDataDeflater() : _initialized(false), _level(0), _smallRatio(0.0f), _skipped(0)
+        {
+            memset(&_stream, 0, sizeof(_stream));
+        }
+
+        ~UpdateDataDeflater()
+        {
+            if (_initialized)
+                deflateEnd(&_stream);
+        }
+
+        // returns 0 when the packet should be sent uncompressed
+        int SelectLevel(size_t size)
+        {
+            if (size <= UPDATE_COMPRESS_MIN_SIZE)
+                return 0;
+
+            if (size < UPDATE_COMPRESS_PROBE_SIZE && _smallRatio > UPDATE_COMPRESS_POOR_RATIO)
+            {
+                if (++_skipped < UPDATE_COMPRESS_PROBE_INTERVAL)
+                    return 0;
+
+                _skipped = 0;
+            }
+
+            if (size >= UPDATE_COMPRESS_FAST_SIZE)
+                return Z_BEST_SPEED;
+
+            // default Z_BEST_SPEED (1)
+            return int(sWorld->getIntConfig(CONFIG_COMPRESSION));
+        }
+
+        void RecordRatio(size_t size, size_t compressedSize)
+        {
+            if (size >= UPDATE_COMPRESS_PROBE_SIZE)
+                return;
+
+            float ratio = float(compressedSize) / float(size);
+            _smallRatio += (ratio - _smallRatio) * 0.125f;
+        }
+
+        z_stream* Acquire(int level)
+        {
+            if (_initialized)
+            {
+                int z_res = deflateReset(&_stream);
+                // nothing is buffered right after a reset, changing the level can't need output space
+                if (z_res == Z_OK && level != _level)
+                    z_res = deflateParams(&_stream, level, Z_DEFAULT_STRATEGY);
+
+                if (z_res == Z_OK)
+                {
+                    _level = level;
+                    return &_stream;
+                }
+
+                // stream left in an unusable state by a failed packet, start over
+                deflateEnd(&_stream);
+                _initialized = false;
+            }
+
+            memset(&_stream, 0, sizeof(_stream));
+            _stream.zalloc = (alloc_func)0;
+            _stream.zfree = (free_func)0;
+            _stream.opaque = (voidpf)0;
+
+            int z_res = deflateInit(&_stream, level);
+            if (z_res != Z_OK)
+            {
+                TC_LOG_ERROR(LOG_FILTER_GENERAL, "Can't compress update packet (zlib: deflateInit) Error code: %i (%s)", z_res, zError(z_res));
+                return NULL;
+            }
+
+            _initialized = true;
+            _level = level;
+            return &_stream;
+        }
+
+    private:
+        z_stream _stream;
+        bool _initialized;
+        int _level;
+        float _smallRatio;
+        uint32 _skipped;
+};
 
-    c_stream.next_out = (Bytef*)dst;
-    c_stream.avail_out = *dst_size;
-    c_stream.next_in = (Bytef*)src;
-    c_stream.avail_in = (uInt)src_size;
+static ACE_TSS<UpdateDataDeflater> Deflater;
 
-    z_res = deflate(&c_stream, Z_NO_FLUSH);
+static bool DeflateInput(z_stream* stream, uint8 const* src, size_t src_size)
+{
+    stream->next_in = (Bytef*)src;
+    stream->avail_in = (uInt)src_size;
+
+    int z_res = deflate(stream, Z_NO_FLUSH);
     if (z_res != Z_OK)
     {
         TC_LOG_ERROR(LOG_FILTER_GENERAL, "Can't compress update packet (zlib: deflate) Error code: %i (%s)", z_res, zError(z_res));
-        *dst_size = 0;
-        return;
+        return false;
     }
 
-    if (c_stream.avail_in != 0)
+    if (stream->avail_in != 0)
     {
         TC_LOG_ERROR(LOG_FILTER_GENERAL, "Can't compress update packet (zlib: deflate not greedy)");
+        return false;
+    }
+
+    return true;
+}
+
+void UpdateData::Compress(void* dst, uint32 *dst_size, ByteBuffer const& header, int level)
+{
+    z_stream* c_stream = Deflater->Acquire(level);
+    if (!c_stream)
+    {
         *dst_size = 0;
         return;
     }
 
-    z_res = deflate(&c_stream, Z_FINISH);
-    if (z_res != Z_STREAM_END)
+    c_stream->next_out = (Bytef*)dst;
+    c_stream->avail_out = *dst_size;
+
+    // header and update blocks are fed as two inputs of the same stream,
+    // the blocks are compressed straight from m_data
+    if (!DeflateInput(c_stream, header.contents(), header.wpos()) ||
+        (m_data.wpos() && !DeflateInput(c_stream, m_data.contents(), m_data.wpos())))
     {
-        TC_LOG_ERROR(LOG_FILTER_GENERAL, "Can't compress update packet (zlib: deflate should report Z_STREAM_END instead %i (%s)", z_res, zError(z_res));
         *dst_size = 0;
         return;
     }
 
-    z_res = deflateEnd(&c_stream);
-    if (z_res != Z_OK)
+    int z_res = deflate(c_stream, Z_FINISH);
+    if (z_res != Z_STREAM_END)
     {
-        TC_LOG_ERROR(LOG_FILTER_GENERAL, "Can't compress update packet (zlib: deflateEnd) Error code: %i (%s)", z_res, zError(z_res));
+        TC_LOG_ERROR(LOG_FILTER_GENERAL, "Can't compress update packet (zlib: deflate should report Z_STREAM_END instead %i (%s)", z_res, zError(z_res));
         *dst_size = 0;
         return;
     }
 
-    *dst_size = c_stream.total_out;
+    *dst_size = c_stream->total_out;
 }
 
 bool UpdateData::BuildPacket(WorldPacket* packet)
 {
     ASSERT(packet->empty());                                // shouldn't happen
 
-    ByteBuffer buf(4 + (m_outOfRangeGUIDs.empty() ? 0 : 1 + 4 + 9 * m_outOfRangeGUIDs.size()) + m_data.wpos());
+    ByteBuffer header(4 + (m_outOfRangeGUIDs.empty() ? 0 : 1 + 4 + 9 * m_outOfRangeGUIDs.size()));
 
-    buf << (uint32) (!m_outOfRangeGUIDs.empty() ? m_blockCount + 1 : m_blockCount);
+    header << (uint32) (!m_outOfRangeGUIDs.empty() ? m_blockCount + 1 : m_blockCount);
 
     if (!m_outOfRangeGUIDs.empty())
     {
-        buf << (uint8) UPDATETYPE_OUT_OF_RANGE_OBJECTS;
-        buf << (uint32) m_outOfRangeGUIDs.size();
+        header << (uint8) UPDATETYPE_OUT_OF_RANGE_OBJECTS;
+        header << (uint32) m_outOfRangeGUIDs.size();
 
         for (std::set<uint64>::const_iterator i = m_outOfRangeGUIDs.begin(); i != m_outOfRangeGUIDs.end(); ++i)
         {
-            buf.appendPackGUID(*i);
+            header.appendPackGUID(*i);
         }
     }
 
-    buf.append(m_data);
+    size_t pSize = header.wpos() + m_data.wpos();           // use real used data size
 
-    size_t pSize = buf.wpos();                              // use real used data size
-
-    if (pSize > 100)                                       // compress large packets
+    UpdateDataDeflater* deflater = Deflater;
+    if (int level = deflater->SelectLevel(pSize))           // compress large packets
     {
         uint32 destsize = compressBound(pSize);
         packet->resize(destsize + sizeof(uint32));
 
         packet->put<uint32>(0, pSize);
-        Compress(const_cast<uint8*>(packet->contents()) + sizeof(uint32), &destsize, (void*)buf.contents(), pSize);
+        Compress(const_cast<uint8*>(packet->contents()) + sizeof(uint32), &destsize, header, level);
         if (destsize == 0)
             return false;
 
-        packet->resize(destsize + sizeof(uint32));
-        packet->SetOpcode(SMSG_COMPRESSED_UPDATE_OBJECT);
-    }
-    else                                                    // send small packets without compression
-    {
-        packet->append(buf);
-        packet->SetOpcode(SMSG_UPDATE_OBJECT);
+        deflater->RecordRatio(pSize, destsize);
+
+        if (destsize + sizeof(uint32) < pSize)
+        {
+            packet->resize(destsize + sizeof(uint32));
+            packet->SetOpcode(SMSG_COMPRESSED_UPDATE_OBJECT);
+            return true;
+        }
+
+        // did not shrink, the plain packet is cheaper for the client too
+        packet->clear();
     }
 
+    // send small packets without compression
+    packet->reserve(pSize);
+    packet->append(header);
+    packet->append(m_data);
+    packet->SetOpcode(SMSG_UPDATE_OBJECT);
+
     return true;
 }
 
@@ -153,3 +283,27 @@ void UpdateData::Clear()
     m_blockCount = 0;
 }
 
+ACE_Atomic_Op<ACE_Thread_Mutex, long> UpdateBlockCache::_totalHits = 0;
+ACE_Atomic_Op<ACE_Thread_Mutex, long> UpdateBlockCache::_totalMisses = 0;
+ACE_Atomic_Op<ACE_Thread_Mutex, long> UpdateBlockCache::_totalPatchedWords = 0;
+
+UpdateBlockCache::~UpdateBlockCache()
+{
+    if (_hits)
+    {
+        _totalHits += _hits;
+        _totalPatchedWords += _patchedWords;
+    }
+
+    if (_misses)
+        _totalMisses += _misses;
+}
+
+UpdateBlockCacheStats UpdateBlockCache::GetStats()
+{
+    UpdateBlockCacheStats stats;
+    stats.Hits = uint64(_totalHits.value());
+    stats.Misses = uint64(_totalMisses.value());
+    stats.PatchedWords = uint64(_totalPatchedWords.value());
+    return stats;
+}
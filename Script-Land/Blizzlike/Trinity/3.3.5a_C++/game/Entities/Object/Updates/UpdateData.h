@@ -20,7 +20,10 @@
 #define __UPDATEDATA_H
 
 #include "ByteBuffer.h"
+#include <ace/Atomic_Op.h>
+#include <ace/Thread_Mutex.h>
 #include <set>
+#include <vector>
 
 class WorldPacket;
 
@@ -49,6 +52,9 @@ enum OBJECT_UPDATE_FLAGS
     UPDATEFLAG_ROTATION             = 0x0200
 };
 
+/// (byte offset in the block, value) of a word rewritten in a shared update block
+typedef std::vector<std::pair<uint32, uint32> > UpdateBlockPatchList;
+
 class UpdateData
 {
     public:
@@ -57,6 +63,7 @@ class UpdateData
         void AddOutOfRangeGUID(std::set<uint64>& guids);
         void AddOutOfRangeGUID(uint64 guid);
         void AddUpdateBlock(const ByteBuffer &block);
+        void AddUpdateBlock(const ByteBuffer &block, UpdateBlockPatchList const& patches);
         bool BuildPacket(WorldPacket* packet);
         bool HasData() const { return m_blockCount > 0 || !m_outOfRangeGUIDs.empty(); }
         void Clear();
@@ -68,7 +75,76 @@ class UpdateData
         std::set<uint64> m_outOfRangeGUIDs;
         ByteBuffer m_data;
 
-        void Compress(void* dst, uint32 *dst_size, void* src, int src_size);
+        void Compress(void* dst, uint32 *dst_size, ByteBuffer const& header, int level);
+};
+
+/// Counters of the values block sharing, summed over all update passes
+struct UpdateBlockCacheStats
+{
+    uint64 Hits;                                            // blocks taken from the cache of an earlier observer
+    uint64 Misses;                                          // blocks serialized and stored for the next observers
+    uint64 PatchedWords;                                    // per target words rewritten in shared blocks
+};
+
+/// Values block of one visibility class, see UpdateBlockCache
+struct UpdateBlockCacheEntry
+{
+    // (field index, byte offset of its value in Block)
+    typedef std::vector<std::pair<uint16, uint32> > PatchSlotList;
+
+    uint32 Key;
+    ByteBuffer Block;
+    PatchSlotList PatchSlots;
+};
+
+/// Update blocks of one object already serialized during a single update pass,
+/// shared between all observers falling in the same visibility class.
+/// Fields serialized differently for each observer are patch slots of the block,
+/// rewritten for every target instead of preventing the sharing.
+class UpdateBlockCache
+{
+    public:
+        UpdateBlockCache() : _hits(0), _misses(0), _patchedWords(0) { }
+        ~UpdateBlockCache();
+
+        UpdateBlockCacheEntry const* Find(uint32 key)
+        {
+            for (EntryList::const_iterator itr = _entries.begin(); itr != _entries.end(); ++itr)
+            {
+                if (itr->Key == key)
+                {
+                    ++_hits;
+                    _patchedWords += itr->PatchSlots.size();
+                    return &*itr;
+                }
+            }
+
+            return NULL;
+        }
+
+        UpdateBlockCacheEntry& Add(uint32 key, ByteBuffer const& block)
+        {
+            ++_misses;
+            _entries.push_back(UpdateBlockCacheEntry());
+            _entries.back().Key = key;
+            _entries.back().Block = block;
+            return _entries.back();
+        }
+
+        static UpdateBlockCacheStats GetStats();
+
+    private:
+        typedef std::vector<UpdateBlockCacheEntry> EntryList;
+        EntryList _entries;
+
+        // flushed into the global counters once the update pass is done
+        uint32 _hits;
+        uint32 _misses;
+        uint32 _patchedWords;
+
+        static ACE_Atomic_Op<ACE_Thread_Mutex, long> _totalHits;
+        static ACE_Atomic_Op<ACE_Thread_Mutex, long> _totalMisses;
+        static ACE_Atomic_Op<ACE_Thread_Mutex, long> _totalPatchedWords;
 };
 #endif
 
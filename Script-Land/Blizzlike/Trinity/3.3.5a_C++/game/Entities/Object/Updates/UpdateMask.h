@@ -23,6 +23,8 @@
 #include "Errors.h"
 #include "ByteBuffer.h"
 
+/// Update field bitset, stored the way the client reads it: one bit per field packed in 32 bit words.
+/// Storage is inline and sized for the largest object (player), so masks can live on the stack.
 class UpdateMask
 {
     public:
@@ -32,33 +34,23 @@ class UpdateMask
         enum UpdateMaskCount
         {
             CLIENT_UPDATE_MASK_BITS = sizeof(ClientUpdateMaskType) * 8,
+            MAX_UPDATE_MASK_BLOCKS  = (PLAYER_END + CLIENT_UPDATE_MASK_BITS - 1) / CLIENT_UPDATE_MASK_BITS,
         };
 
-        UpdateMask() : _fieldCount(0), _blockCount(0), _bits(NULL) { }
+        UpdateMask() : _fieldCount(0), _blockCount(0) { }
+        explicit UpdateMask(uint32 valuesCount) { SetCount(valuesCount); }
 
-        UpdateMask(UpdateMask const& right)
-        {
-            SetCount(right.GetCount());
-            memcpy(_bits, right._bits, sizeof(uint8) * _blockCount * 32);
-        }
+        void SetBit(uint32 index) { _blocks[index / CLIENT_UPDATE_MASK_BITS] |= ClientUpdateMaskType(1) << (index % CLIENT_UPDATE_MASK_BITS); }
+        void UnsetBit(uint32 index) { _blocks[index / CLIENT_UPDATE_MASK_BITS] &= ~(ClientUpdateMaskType(1) << (index % CLIENT_UPDATE_MASK_BITS)); }
+        bool GetBit(uint32 index) const { return (_blocks[index / CLIENT_UPDATE_MASK_BITS] & (ClientUpdateMaskType(1) << (index % CLIENT_UPDATE_MASK_BITS))) != 0; }
 
-        ~UpdateMask() { delete[] _bits; }
+        ClientUpdateMaskType GetBlock(uint32 block) const { return _blocks[block]; }
+        void SetBlock(uint32 block, ClientUpdateMaskType bits) { _blocks[block] = bits; }
 
-        void SetBit(uint32 index) { _bits[index] = 1; }
-        void UnsetBit(uint32 index) { _bits[index] = 0; }
-        bool GetBit(uint32 index) const { return _bits[index] != 0; }
-
-        void AppendToPacket(ByteBuffer* data)
+        void AppendToPacket(ByteBuffer* data) const
         {
-            for (uint32 i = 0; i < GetBlockCount(); ++i)
-            {
-                ClientUpdateMaskType maskPart = 0;
-                for (uint32 j = 0; j < CLIENT_UPDATE_MASK_BITS; ++j)
-                    if (_bits[CLIENT_UPDATE_MASK_BITS * i + j])
-                        maskPart |= 1 << j;
-
-                *data << maskPart;
-            }
+            for (uint32 i = 0; i < _blockCount; ++i)
+                *data << _blocks[i];
         }
 
         uint32 GetBlockCount() const { return _blockCount; }
@@ -66,36 +58,64 @@ class UpdateMask
 
         void SetCount(uint32 valuesCount)
         {
-            delete[] _bits;
+            ASSERT(valuesCount <= MAX_UPDATE_MASK_BLOCKS * CLIENT_UPDATE_MASK_BITS);
 
             _fieldCount = valuesCount;
             _blockCount = (valuesCount + CLIENT_UPDATE_MASK_BITS - 1) / CLIENT_UPDATE_MASK_BITS;
-
-            _bits = new uint8[_blockCount * CLIENT_UPDATE_MASK_BITS];
-            memset(_bits, 0, sizeof(uint8) * _blockCount * CLIENT_UPDATE_MASK_BITS);
+            Clear();
         }
 
         void Clear()
         {
-            if (_bits)
-                memset(_bits, 0, sizeof(uint8) * _blockCount * CLIENT_UPDATE_MASK_BITS);
+            memset(_blocks, 0, sizeof(ClientUpdateMaskType) * _blockCount);
         }
 
-        UpdateMask& operator=(UpdateMask const& right)
+        bool IsEmpty() const
         {
-            if (this == &right)
-                return *this;
+            for (uint32 i = 0; i < _blockCount; ++i)
+                if (_blocks[i])
+                    return false;
 
-            SetCount(right.GetCount());
-            memcpy(_bits, right._bits, sizeof(uint8) * _blockCount * CLIENT_UPDATE_MASK_BITS);
-            return *this;
+            return true;
+        }
+
+        /// Clears the bits past GetCount() in the last block, left over by whole-block operations
+        void TrimToCount()
+        {
+            if (uint32 tail = _fieldCount % CLIENT_UPDATE_MASK_BITS)
+                _blocks[_blockCount - 1] &= (ClientUpdateMaskType(1) << tail) - 1;
+        }
+
+        /// Returns the first set bit at or after index, GetCount() if there is none.
+        /// Empty blocks are skipped a whole word at a time.
+        uint32 FindNextSetBit(uint32 index) const
+        {
+            if (index >= _fieldCount)
+                return _fieldCount;
+
+            uint32 block = index / CLIENT_UPDATE_MASK_BITS;
+            ClientUpdateMaskType bits = _blocks[block] & (~ClientUpdateMaskType(0) << (index % CLIENT_UPDATE_MASK_BITS));
+
+            while (!bits)
+            {
+                if (++block >= _blockCount)
+                    return _fieldCount;
+
+                bits = _blocks[block];
+            }
+
+            index = block * CLIENT_UPDATE_MASK_BITS + CountTrailingZeros(bits);
+            return index < _fieldCount ? index : _fieldCount;
         }
 
         UpdateMask& operator&=(UpdateMask const& right)
         {
             ASSERT(right.GetCount() <= GetCount());
-            for (uint32 i = 0; i < _fieldCount; ++i)
-                _bits[i] &= right._bits[i];
+            for (uint32 i = 0; i < right._blockCount; ++i)
+                _blocks[i] &= right._blocks[i];
+
+            for (uint32 i = right._blockCount; i < _blockCount; ++i)
+                _blocks[i] = 0;
 
             return *this;
         }
@@ -103,8 +123,8 @@ class UpdateMask
         UpdateMask& operator|=(UpdateMask const& right)
         {
             ASSERT(right.GetCount() <= GetCount());
-            for (uint32 i = 0; i < _fieldCount; ++i)
-                _bits[i] |= right._bits[i];
+            for (uint32 i = 0; i < right._blockCount; ++i)
+                _blocks[i] |= right._blocks[i];
 
             return *this;
         }
@@ -117,9 +137,24 @@ class UpdateMask
         }
 
     private:
+        static uint32 CountTrailingZeros(ClientUpdateMaskType bits)
+        {
+#if defined(__GNUC__)
+            return __builtin_ctz(bits);
+#else
+            uint32 count = 0;
+            while (!(bits & 1))
+            {
+                bits >>= 1;
+                ++count;
+            }
+            return count;
+#endif
+        }
+
         uint32 _fieldCount;
         uint32 _blockCount;
-        uint8* _bits;
+        ClientUpdateMaskType _blocks[MAX_UPDATE_MASK_BLOCKS];
 };
 
 #endif
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2008-2013 TrinityCore <http://www.trinitycore.org/>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TRINITY_CLIENTGUIDSET_H
+#define __TRINITY_CLIENTGUIDSET_H
+
+#include "Define.h"
+#include "Errors.h"
+
+#include <algorithm>
+#include <vector>
+
+// smallest table allocated on first insert
+#define CLIENT_GUID_SET_MIN_CAPACITY    64
+
+/**
+ * Set of the object GUIDs a player client currently knows about.
+ *
+ * Open addressed with linear probing in one flat array, GUID 0 marks a free
+ * slot. The table is kept at most half full, so a lookup touches one or two
+ * cache lines in the common case; erase shifts the following entries back
+ * instead of leaving tombstones. Inserting or erasing invalidates iterators,
+ * and iteration order is unspecified.
+ */
+class ClientGUIDSet
+{
+    public:
+        class const_iterator
+        {
+            public:
+                const_iterator() : _slots(NULL), _index(0), _capacity(0) { }
+
+                uint64 const& operator*() const { return _slots[_index]; }
+                uint64 const* operator->() const { return &_slots[_index]; }
+
+                const_iterator& operator++() { ++_index; SkipFree(); return *this; }
+                const_iterator operator++(int) { const_iterator tmp(*this); ++*this; return tmp; }
+
+                bool operator==(const_iterator const& right) const { return _index == right._index; }
+                bool operator!=(const_iterator const& right) const { return _index != right._index; }
+
+            private:
+                friend class ClientGUIDSet;
+
+                const_iterator(uint64 const* slots, uint32 index, uint32 capacity) : _slots(slots), _index(index), _capacity(capacity) { SkipFree(); }
+
+                void SkipFree() { while (_index < _capacity && !_slots[_index]) ++_index; }
+
+                uint64 const* _slots;
+                uint32 _index;
+                uint32 _capacity;
+        };
+
+        typedef const_iterator iterator;
+
+        ClientGUIDSet() : _size(0), _shift(64) { }
+
+        const_iterator begin() const { return const_iterator(_slots.empty() ? NULL : &_slots[0], 0, Capacity()); }
+        const_iterator end() const { return const_iterator(NULL, Capacity(), Capacity()); }
+
+        bool empty() const { return !_size; }
+        uint32 size() const { return _size; }
+
+        const_iterator find(uint64 guid) const
+        {
+            uint32 index;
+            if (!Lookup(guid, index))
+                return end();
+
+            return const_iterator(&_slots[0], index, Capacity());
+        }
+
+        uint32 count(uint64 guid) const
+        {
+            uint32 index;
+            return Lookup(guid, index) ? 1 : 0;
+        }
+
+        bool insert(uint64 guid)
+        {
+            ASSERT(guid);
+
+            // keep at least half of the slots free
+            if ((_size + 1) * 2 > Capacity())
+                Rehash(Capacity() ? Capacity() * 2 : CLIENT_GUID_SET_MIN_CAPACITY);
+
+            uint32 mask = Capacity() - 1;
+            for (uint32 index = Home(guid); ; index = (index + 1) & mask)
+            {
+                if (_slots[index] == guid)
+                    return false;
+
+                if (!_slots[index])
+                {
+                    _slots[index] = guid;
+                    ++_size;
+                    return true;
+                }
+            }
+        }
+
+        uint32 erase(uint64 guid)
+        {
+            uint32 hole;
+            if (!Lookup(guid, hole))
+                return 0;
+
+            // move back every entry of the probe run that could not live in the hole's slot before
+            uint32 mask = Capacity() - 1;
+            for (uint32 index = (hole + 1) & mask; _slots[index]; index = (index + 1) & mask)
+            {
+                uint32 home = Home(_slots[index]);
+                if (((index - home) & mask) >= ((index - hole) & mask))
+                {
+                    _slots[hole] = _slots[index];
+                    hole = index;
+                }
+            }
+
+            _slots[hole] = 0;
+            --_size;
+            return 1;
+        }
+
+        // keeps the table allocated, a player changing map refills it right away
+        void clear()
+        {
+            if (_size)
+                std::fill(_slots.begin(), _slots.end(), uint64(0));
+
+            _size = 0;
+        }
+
+    private:
+        uint32 Capacity() const { return uint32(_slots.size()); }
+
+        // fibonacci hashing, GUID low parts are sequential and would cluster with a plain mask
+        uint32 Home(uint64 guid) const { return uint32((guid * UI64LIT(0x9E3779B97F4A7C15)) >> _shift); }
+
+        bool Lookup(uint64 guid, uint32& index) const
+        {
+            if (!_size || !guid)
+                return false;
+
+            uint32 mask = Capacity() - 1;
+            for (index = Home(guid); _slots[index]; index = (index + 1) & mask)
+                if (_slots[index] == guid)
+                    return true;
+
+            return false;
+        }
+
+        void Rehash(uint32 capacity)
+        {
+            std::vector<uint64> old(capacity, uint64(0));
+            old.swap(_slots);
+
+            _shift = 64;
+            for (uint32 i = capacity; i > 1; i >>= 1)
+                --_shift;
+
+            uint32 mask = capacity - 1;
+            for (std::vector<uint64>::const_iterator itr = old.begin(); itr != old.end(); ++itr)
+            {
+                if (!*itr)
+                    continue;
+
+                uint32 index = Home(*itr);
+                while (_slots[index])
+                    index = (index + 1) & mask;
+
+                _slots[index] = *itr;
+            }
+        }
+
+        std::vector<uint64> _slots;
+        uint32 _size;
+        uint32 _shift;                                      // 64 - log2(capacity)
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include "GroupReference.h"
 #include "MapReference.h"
 
+#include "ClientGUIDSet.h"
 #include "Item.h"
 #include "PetDefines.h"
 #include "QuestDef.h"
@@ -2120,7 +2121,7 @@ class Player : public Unit, public GridObject<Player>
         WorldLocation GetStartPosition() const;
 
         // currently visible objects at player client
-        typedef std::set<uint64> ClientGUIDs;
+        typedef ClientGUIDSet ClientGUIDs;
         ClientGUIDs m_clientGUIDs;
 
         bool HaveAtClient(WorldObject const* u) const;
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2008-2013 TrinityCore <http://www.trinitycore.org/>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TRINITY_FLATAURAMAP_H
+#define __TRINITY_FLATAURAMAP_H
+
+#include "Define.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**
+ * Spell id -> aura multimap kept as one vector sorted by spell id.
+ *
+ * Entries with the same spell id stay in insertion order, like std::multimap.
+ * A unit rarely carries more than a few dozen auras, so the binary search and
+ * the element shifting on insert/erase stay within a few cache lines, and the
+ * per tick walk over all auras no longer chases tree nodes.
+ *
+ * Aura code holds iterators across calls that add or remove other auras (the
+ * owned aura update iterator, equal_range bounds), which std::multimap allows.
+ * To keep that working every iterator remembers the entry it points at; after
+ * the storage was shifted it looks the entry up again by spell id and value.
+ * Only iterators to the erased entry itself become invalid.
+ */
+template<class T>
+class FlatAuraMap
+{
+        typedef std::pair<uint32, T*> Entry;
+
+    public:
+        typedef uint32 key_type;
+        typedef T* mapped_type;
+        typedef Entry value_type;
+        typedef uint32 size_type;
+
+        template<class Map, class Value>
+        class Iterator
+        {
+            public:
+                Iterator() : _map(NULL), _index(0), _key(0), _value(NULL), _version(0) { }
+
+                // iterator to const_iterator
+                template<class OtherMap, class OtherValue>
+                Iterator(Iterator<OtherMap, OtherValue> const& right) :
+                    _map(right._map), _index(right._index), _key(right._key), _value(right._value), _version(right._version) { }
+
+                Value& operator*() const { Sync(); return _map->_entries[_index]; }
+                Value* operator->() const { Sync(); return &_map->_entries[_index]; }
+
+                Iterator& operator++() { Sync(); ++_index; Bind(); return *this; }
+                Iterator operator++(int) { Iterator tmp(*this); ++*this; return tmp; }
+
+                template<class OtherMap, class OtherValue>
+                bool operator==(Iterator<OtherMap, OtherValue> const& right) const { Sync(); right.Sync(); return _index == right._index; }
+
+                template<class OtherMap, class OtherValue>
+                bool operator!=(Iterator<OtherMap, OtherValue> const& right) const { return !(*this == right); }
+
+            private:
+                template<class, class> friend class Iterator;
+                friend class FlatAuraMap;
+
+                Iterator(Map* map, uint32 index) : _map(map), _index(index) { Bind(); }
+
+                // remember the entry, end() is remembered as a NULL value
+                void Bind()
+                {
+                    _version = _map->_version;
+                    if (_index < _map->_entries.size())
+                    {
+                        _key = _map->_entries[_index].first;
+                        _value = _map->_entries[_index].second;
+                    }
+                    else
+                    {
+                        _key = 0;
+                        _value = NULL;
+                    }
+                }
+
+                void Sync() const
+                {
+                    if (_map && _version != _map->_version)
+                    {
+                        _index = _map->Locate(_key, _value);
+                        _version = _map->_version;
+                    }
+                }
+
+                Map* _map;
+                mutable uint32 _index;
+                uint32 _key;
+                T* _value;
+                mutable uint32 _version;                    // storage layout the index was computed for
+        };
+
+        typedef Iterator<FlatAuraMap, value_type> iterator;
+        typedef Iterator<FlatAuraMap const, value_type const> const_iterator;
+
+        FlatAuraMap() : _version(0) { }
+
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, size()); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, size()); }
+
+        bool empty() const { return _entries.empty(); }
+        size_type size() const { return size_type(_entries.size()); }
+
+        iterator insert(value_type const& value)
+        {
+            // after the entries with the same spell id, as std::multimap does
+            uint32 index = UpperBound(value.first);
+            _entries.insert(_entries.begin() + index, value);
+            ++_version;
+            return iterator(this, index);
+        }
+
+        void erase(iterator itr)
+        {
+            itr.Sync();
+            _entries.erase(_entries.begin() + itr._index);
+            ++_version;
+        }
+
+        void clear()
+        {
+            _entries.clear();
+            ++_version;
+        }
+
+        iterator find(key_type key)
+        {
+            uint32 index = LowerBound(key);
+            return iterator(this, index < size() && _entries[index].first == key ? index : size());
+        }
+
+        const_iterator find(key_type key) const
+        {
+            uint32 index = LowerBound(key);
+            return const_iterator(this, index < size() && _entries[index].first == key ? index : size());
+        }
+
+        size_type count(key_type key) const { return UpperBound(key) - LowerBound(key); }
+
+        iterator lower_bound(key_type key) { return iterator(this, LowerBound(key)); }
+        iterator upper_bound(key_type key) { return iterator(this, UpperBound(key)); }
+        const_iterator lower_bound(key_type key) const { return const_iterator(this, LowerBound(key)); }
+        const_iterator upper_bound(key_type key) const { return const_iterator(this, UpperBound(key)); }
+
+        std::pair<iterator, iterator> equal_range(key_type key) { return std::make_pair(lower_bound(key), upper_bound(key)); }
+        std::pair<const_iterator, const_iterator> equal_range(key_type key) const { return std::make_pair(lower_bound(key), upper_bound(key)); }
+
+    private:
+        template<class, class> friend class Iterator;
+
+        FlatAuraMap(FlatAuraMap const&);
+        FlatAuraMap& operator=(FlatAuraMap const&);
+
+        struct KeyLess
+        {
+            bool operator()(Entry const& left, uint32 right) const { return left.first < right; }
+            bool operator()(uint32 left, Entry const& right) const { return left < right.first; }
+            bool operator()(Entry const& left, Entry const& right) const { return left.first < right.first; }
+        };
+
+        uint32 LowerBound(key_type key) const { return uint32(std::lower_bound(_entries.begin(), _entries.end(), key, KeyLess()) - _entries.begin()); }
+        uint32 UpperBound(key_type key) const { return uint32(std::upper_bound(_entries.begin(), _entries.end(), key, KeyLess()) - _entries.begin()); }
+
+        // current index of an entry an iterator pointed at; an erased entry resolves to the position after its spell id
+        uint32 Locate(key_type key, T* value) const
+        {
+            if (!value)
+                return size();
+
+            uint32 index = LowerBound(key);
+            for (uint32 i = index; i < size() && _entries[i].first == key; ++i)
+                if (_entries[i].second == value)
+                    return i;
+
+            return UpperBound(key);
+        }
+
+        std::vector<Entry> _entries;
+        uint32 _version;                                    // bumped whenever entries are inserted or erased
+};
+
+#endif
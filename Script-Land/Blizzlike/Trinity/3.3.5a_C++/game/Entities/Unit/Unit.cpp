@@ -167,7 +167,7 @@ Unit::Unit(bool isWorldObject) :
     i_AI(NULL), i_disabledAI(NULL), m_AutoRepeatFirstCast(false), m_procDeep(0),
     m_removedAurasCount(0), i_motionMaster(this), m_ThreatManager(this),
     m_vehicle(NULL), m_vehicleKit(NULL), m_unitTypeMask(UNIT_MASK_NONE),
-    m_HostileRefManager(this), _lastDamagedTime(0)
+    m_HostileRefManager(this), _lastDamagedTime(0), m_hasVisibilityNotifyPos(false)
 {
 #ifdef _MSC_VER
 #pragma warning(default:4355)
@@ -206,6 +206,8 @@ Unit::Unit(bool isWorldObject) :
     m_auraUpdateIterator = m_ownedAuras.end();
 
     m_interruptMask = 0;
+    m_procAuraFlags = 0;
+    m_procAurasGeneration = sSpellMgr->GetSpellProcGeneration();
     m_transform = 0;
     m_canModifyStats = false;
 
@@ -245,6 +247,8 @@ Unit::Unit(bool isWorldObject) :
 
     m_isSorted = true;
 
+    memset(m_modAuraSlots, 0, sizeof(m_modAuraSlots));
+
     for (uint8 i = 0; i < MAX_MOVE_TYPE; ++i)
         m_speed_rate[i] = 1.0f;
 
@@ -301,6 +305,9 @@ Unit::~Unit()
     delete m_charmInfo;
     delete movespline;
 
+    for (std::vector<ModAuraSlot*>::const_iterator itr = m_modAuraLists.begin(); itr != m_modAuraLists.end(); ++itr)
+        delete *itr;
+
     ASSERT(!m_duringRemoveFromWorld);
     ASSERT(!m_attacking);
     ASSERT(m_attackers.empty());
@@ -517,6 +524,47 @@ void Unit::UpdateInterruptMask()
             m_interruptMask |= spell->m_spellInfo->ChannelInterruptFlags;
 }
 
+void Unit::_RegisterProcAura(AuraApplication* aurApp)
+{
+    aurApp->_procFlags = sSpellMgr->GetSpellProcEventFlags(aurApp->GetBase()->GetSpellInfo());
+    if (!aurApp->_procFlags)
+        return;
+
+    m_procAuras.insert(AuraApplicationMap::value_type(aurApp->GetBase()->GetId(), aurApp));
+    m_procAuraFlags |= aurApp->_procFlags;
+}
+
+void Unit::_UnregisterProcAura(AuraApplication* aurApp)
+{
+    if (!aurApp->GetProcFlags())
+        return;
+
+    AuraApplicationMapBoundsNonConst range = m_procAuras.equal_range(aurApp->GetBase()->GetId());
+    for (AuraApplicationMap::iterator itr = range.first; itr != range.second; ++itr)
+    {
+        if (itr->second == aurApp)
+        {
+            m_procAuras.erase(itr);
+            break;
+        }
+    }
+
+    m_procAuraFlags = 0;
+    for (AuraApplicationMap::const_iterator itr = m_procAuras.begin(); itr != m_procAuras.end(); ++itr)
+        m_procAuraFlags |= itr->second->GetProcFlags();
+}
+
+// proc data was reloaded, index the applied auras again with the new flags
+void Unit::_RebuildProcAuras()
+{
+    m_procAuras.clear();
+    m_procAuraFlags = 0;
+    m_procAurasGeneration = sSpellMgr->GetSpellProcGeneration();
+
+    for (AuraApplicationMap::const_iterator itr = m_appliedAuras.begin(); itr != m_appliedAuras.end(); ++itr)
+        _RegisterProcAura(itr->second);
+}
+
 bool Unit::HasAuraTypeWithFamilyFlags(AuraType auraType, uint32 familyName, uint32 familyFlags) const
 {
     if (!HasAuraType(auraType))
@@ -3309,6 +3357,7 @@ AuraApplication * Unit::_CreateAuraApplication(Aura* aura, uint8 effMask)
 
     AuraApplication * aurApp = new AuraApplication(this, caster, aura, effMask);
     m_appliedAuras.insert(AuraApplicationMap::value_type(aurId, aurApp));
+    _RegisterProcAura(aurApp);
 
     if (aurSpellInfo->AuraInterruptFlags)
     {
@@ -3393,6 +3442,7 @@ void Unit::_UnapplyAura(AuraApplicationMap::iterator &i, AuraRemoveMode removeMo
 
     // Remove all pointers from lists here to prevent possible pointer invalidation on spellcast/auraapply/auraremove
     m_appliedAuras.erase(i);
+    _UnregisterProcAura(aurApp);
 
     if (aura->GetSpellInfo()->AuraInterruptFlags)
     {
@@ -3502,9 +3552,28 @@ void Unit::_RemoveNoStackAurasDueToAura(Aura* aura)
 void Unit::_RegisterAuraEffect(AuraEffect* aurEff, bool apply)
 {
     if (apply)
-        m_modAuras[aurEff->GetAuraType()].push_back(aurEff);
-    else
-        m_modAuras[aurEff->GetAuraType()].remove(aurEff);
+        GetOrCreateModAuraList(aurEff->GetAuraType()).push_back(aurEff);
+    else if (AuraEffectList* list = GetModAuraList(aurEff->GetAuraType()))
+        list->remove(aurEff);
+
+    _InvalidateAuraModifierCache(aurEff->GetAuraType());
+}
+
+void Unit::_InvalidateAuraModifierCache(AuraType type)
+{
+    if (ModAuraSlot* slot = GetModAuraSlot(type))
+        slot->ModifierCache.clear();
+}
+
+Unit::AuraEffectList& Unit::GetOrCreateModAuraList(AuraType type)
+{
+    if (!m_modAuraSlots[type])
+    {
+        m_modAuraLists.push_back(new ModAuraSlot());
+        m_modAuraSlots[type] = uint16(m_modAuraLists.size());
+    }
+
+    return m_modAuraLists[m_modAuraSlots[type] - 1]->Effects;
 }
 
 // All aura base removes should go threw this function!
@@ -3805,7 +3874,11 @@ void Unit::RemoveAurasDueToItemSpell(uint32 spellId, uint64 castItemGuid)
 
 void Unit::RemoveAurasByType(AuraType auraType, uint64 casterGUID, Aura* except, bool negative, bool positive)
 {
-    for (AuraEffectList::iterator iter = m_modAuras[auraType].begin(); iter != m_modAuras[auraType].end();)
+    AuraEffectList* auraList = GetModAuraList(auraType);
+    if (!auraList)
+        return;
+
+    for (AuraEffectList::iterator iter = auraList->begin(); iter != auraList->end();)
     {
         Aura* aura = (*iter)->GetBase();
         AuraApplication * aurApp = aura->GetApplicationOfTarget(GetGUID());
@@ -3817,7 +3890,7 @@ void Unit::RemoveAurasByType(AuraType auraType, uint64 casterGUID, Aura* except,
             uint32 removedAuras = m_removedAurasCount;
             RemoveAura(aurApp);
             if (m_removedAurasCount > removedAuras + 1)
-                iter = m_modAuras[auraType].begin();
+                iter = auraList->begin();
         }
     }
 }
@@ -4288,7 +4361,8 @@ bool Unit::HasAura(uint32 spellId, uint64 casterGUID, uint64 itemCasterGUID, uin
 
 bool Unit::HasAuraType(AuraType auraType) const
 {
-    return (!m_modAuras[auraType].empty());
+    AuraEffectList const* auraList = GetModAuraList(auraType);
+    return auraList && !auraList->empty();
 }
 
 bool Unit::HasAuraTypeWithCaster(AuraType auratype, uint64 caster) const
@@ -4391,7 +4465,11 @@ uint32 Unit::GetDiseasesByCaster(uint64 casterGUID, bool remove)
     uint32 diseases = 0;
     for (AuraType const* itr = diseaseAuraTypes; *itr != SPELL_AURA_NONE; ++itr)
     {
-        for (AuraEffectList::iterator i = m_modAuras[*itr].begin(); i != m_modAuras[*itr].end();)
+        AuraEffectList* auraList = GetModAuraList(*itr);
+        if (!auraList)
+            continue;
+
+        for (AuraEffectList::iterator i = auraList->begin(); i != auraList->end();)
         {
             // Get auras with disease dispel type by caster
             if ((*i)->GetSpellInfo()->Dispel == DISPEL_DISEASE
@@ -4402,7 +4480,7 @@ uint32 Unit::GetDiseasesByCaster(uint64 casterGUID, bool remove)
                 if (remove)
                 {
                     RemoveAura((*i)->GetId(), (*i)->GetCasterGUID());
-                    i = m_modAuras[*itr].begin();
+                    i = auraList->begin();
                     continue;
                 }
             }
@@ -4435,102 +4513,112 @@ uint32 Unit::GetDoTsByCaster(uint64 casterGUID) const
     return dots;
 }
 
-int32 Unit::GetTotalAuraModifier(AuraType auratype) const
+AuraModifierCacheEntry Unit::GetAuraModifierCache(AuraType type, AuraModifierFilter filter, int32 misc) const
 {
-    std::map<SpellGroup, int32> SameEffectSpellGroup;
-    int32 modifier = 0;
+    AuraModifierCacheEntry entry;
+    entry.Filter = uint8(filter);
+    entry.Misc = misc;
+    entry.Total = 0;
+    entry.Multiplier = 1.0f;
+    entry.MaxPositive = 0;
+    entry.MaxNegative = 0;
 
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-        if (!sSpellMgr->AddSameEffectStackRuleSpellGroups((*i)->GetSpellInfo(), (*i)->GetAmount(), SameEffectSpellGroup))
-            modifier += (*i)->GetAmount();
-
-    for (std::map<SpellGroup, int32>::const_iterator itr = SameEffectSpellGroup.begin(); itr != SameEffectSpellGroup.end(); ++itr)
-        modifier += itr->second;
+    // no effect of this type was ever applied, every aggregate is neutral
+    ModAuraSlot* slot = GetModAuraSlot(type);
+    if (!slot)
+        return entry;
 
-    return modifier;
-}
+    std::vector<AuraModifierCacheEntry>& cache = slot->ModifierCache;
+    for (std::vector<AuraModifierCacheEntry>::const_iterator itr = cache.begin(); itr != cache.end(); ++itr)
+        if (itr->Filter == filter && itr->Misc == misc)
+            return *itr;
 
-float Unit::GetTotalAuraMultiplier(AuraType auratype) const
-{
-    float multiplier = 1.0f;
+    SameEffectSpellGroupAmounts sameEffectSpellGroup;
+    for (AuraEffectList::const_iterator i = slot->Effects.begin(); i != slot->Effects.end(); ++i)
+    {
+        if (filter == AURA_MODIFIER_FILTER_MISC_MASK && !((*i)->GetMiscValue() & misc))
+            continue;
+        if (filter == AURA_MODIFIER_FILTER_MISC_VALUE && (*i)->GetMiscValue() != misc)
+            continue;
 
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-        AddPct(multiplier, (*i)->GetAmount());
+        int32 amount = (*i)->GetAmount();
+        if (amount > entry.MaxPositive)
+            entry.MaxPositive = amount;
+        if (amount < entry.MaxNegative)
+            entry.MaxNegative = amount;
 
-    return multiplier;
-}
+        // the unfiltered multiplier never honored the same effect stack rule
+        if (filter == AURA_MODIFIER_FILTER_NONE)
+            AddPct(entry.Multiplier, amount);
 
-int32 Unit::GetMaxPositiveAuraModifier(AuraType auratype) const
-{
-    int32 modifier = 0;
+        // Check if the Aura Effect has a the Same Effect Stack Rule and if so, use the highest amount of that SpellGroup
+        // If the Aura Effect does not have this Stack Rule, it returns false so we can add to the totals as usual
+        if (!sSpellMgr->AddSameEffectStackRuleSpellGroups((*i)->GetSpellInfo(), amount, sameEffectSpellGroup))
+        {
+            entry.Total += amount;
+            if (filter != AURA_MODIFIER_FILTER_NONE)
+                AddPct(entry.Multiplier, amount);
+        }
+    }
 
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
+    // Add the highest of the Same Effect Stack Rule SpellGroups
+    for (uint32 i = 0; i < sameEffectSpellGroup.size(); ++i)
     {
-        if ((*i)->GetAmount() > modifier)
-            modifier = (*i)->GetAmount();
+        entry.Total += sameEffectSpellGroup.GetAmount(i);
+        if (filter != AURA_MODIFIER_FILTER_NONE)
+            AddPct(entry.Multiplier, sameEffectSpellGroup.GetAmount(i));
     }
 
-    return modifier;
-}
+    // region jobs of the map may query the same unit from several threads at once,
+    // the cache is only filled by the serial part of the map update
+    Map* map = FindMap();
+    if (map && map->IsUpdatingRegions())
+        return entry;
 
-int32 Unit::GetMaxNegativeAuraModifier(AuraType auratype) const
-{
-    int32 modifier = 0;
-
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-        if ((*i)->GetAmount() < modifier)
-            modifier = (*i)->GetAmount();
+    if (cache.size() >= MAX_AURA_MODIFIER_CACHE_ENTRIES)
+        cache.clear();
 
-    return modifier;
+    cache.push_back(entry);
+    return entry;
 }
 
-int32 Unit::GetTotalAuraModifierByMiscMask(AuraType auratype, uint32 miscMask) const
+int32 Unit::GetTotalAuraModifier(AuraType auratype) const
 {
-    std::map<SpellGroup, int32> SameEffectSpellGroup;
-    int32 modifier = 0;
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_NONE, 0).Total;
+}
 
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
+float Unit::GetTotalAuraMultiplier(AuraType auratype) const
+{
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_NONE, 0).Multiplier;
+}
 
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-        if ((*i)->GetMiscValue() & miscMask)
-            if (!sSpellMgr->AddSameEffectStackRuleSpellGroups((*i)->GetSpellInfo(), (*i)->GetAmount(), SameEffectSpellGroup))
-                modifier += (*i)->GetAmount();
+int32 Unit::GetMaxPositiveAuraModifier(AuraType auratype) const
+{
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_NONE, 0).MaxPositive;
+}
 
-    for (std::map<SpellGroup, int32>::const_iterator itr = SameEffectSpellGroup.begin(); itr != SameEffectSpellGroup.end(); ++itr)
-        modifier += itr->second;
+int32 Unit::GetMaxNegativeAuraModifier(AuraType auratype) const
+{
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_NONE, 0).MaxNegative;
+}
 
-    return modifier;
+int32 Unit::GetTotalAuraModifierByMiscMask(AuraType auratype, uint32 miscMask) const
+{
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_MISC_MASK, int32(miscMask)).Total;
 }
 
 float Unit::GetTotalAuraMultiplierByMiscMask(AuraType auratype, uint32 miscMask) const
 {
-    std::map<SpellGroup, int32> SameEffectSpellGroup;
-    float multiplier = 1.0f;
-
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-    {
-        if (((*i)->GetMiscValue() & miscMask))
-        {
-            // Check if the Aura Effect has a the Same Effect Stack Rule and if so, use the highest amount of that SpellGroup
-            // If the Aura Effect does not have this Stack Rule, it returns false so we can add to the multiplier as usual
-            if (!sSpellMgr->AddSameEffectStackRuleSpellGroups((*i)->GetSpellInfo(), (*i)->GetAmount(), SameEffectSpellGroup))
-                AddPct(multiplier, (*i)->GetAmount());
-        }
-    }
-    // Add the highest of the Same Effect Stack Rule SpellGroups to the multiplier
-    for (std::map<SpellGroup, int32>::const_iterator itr = SameEffectSpellGroup.begin(); itr != SameEffectSpellGroup.end(); ++itr)
-        AddPct(multiplier, itr->second);
-
-    return multiplier;
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_MISC_MASK, int32(miscMask)).Multiplier;
 }
 
 int32 Unit::GetMaxPositiveAuraModifierByMiscMask(AuraType auratype, uint32 miscMask, const AuraEffect* except) const
 {
+    if (!except)
+    {
+        return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_MISC_MASK, int32(miscMask)).MaxPositive;
+    }
+
     int32 modifier = 0;
 
     AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
@@ -4545,87 +4633,32 @@ int32 Unit::GetMaxPositiveAuraModifierByMiscMask(AuraType auratype, uint32 miscM
 
 int32 Unit::GetMaxNegativeAuraModifierByMiscMask(AuraType auratype, uint32 miscMask) const
 {
-    int32 modifier = 0;
-
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-    {
-        if ((*i)->GetMiscValue()& miscMask && (*i)->GetAmount() < modifier)
-            modifier = (*i)->GetAmount();
-    }
-
-    return modifier;
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_MISC_MASK, int32(miscMask)).MaxNegative;
 }
 
 int32 Unit::GetTotalAuraModifierByMiscValue(AuraType auratype, int32 miscValue) const
 {
-    std::map<SpellGroup, int32> SameEffectSpellGroup;
-    int32 modifier = 0;
-
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-    {
-        if ((*i)->GetMiscValue() == miscValue)
-            if (!sSpellMgr->AddSameEffectStackRuleSpellGroups((*i)->GetSpellInfo(), (*i)->GetAmount(), SameEffectSpellGroup))
-                modifier += (*i)->GetAmount();
-    }
-
-    for (std::map<SpellGroup, int32>::const_iterator itr = SameEffectSpellGroup.begin(); itr != SameEffectSpellGroup.end(); ++itr)
-        modifier += itr->second;
-
-    return modifier;
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_MISC_VALUE, miscValue).Total;
 }
 
 float Unit::GetTotalAuraMultiplierByMiscValue(AuraType auratype, int32 miscValue) const
 {
-    std::map<SpellGroup, int32> SameEffectSpellGroup;
-    float multiplier = 1.0f;
-
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-    {
-        if ((*i)->GetMiscValue() == miscValue)
-            if (!sSpellMgr->AddSameEffectStackRuleSpellGroups((*i)->GetSpellInfo(), (*i)->GetAmount(), SameEffectSpellGroup))
-                AddPct(multiplier, (*i)->GetAmount());
-    }
-
-    for (std::map<SpellGroup, int32>::const_iterator itr = SameEffectSpellGroup.begin(); itr != SameEffectSpellGroup.end(); ++itr)
-        AddPct(multiplier, itr->second);
-
-    return multiplier;
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_MISC_VALUE, miscValue).Multiplier;
 }
 
 int32 Unit::GetMaxPositiveAuraModifierByMiscValue(AuraType auratype, int32 miscValue) const
 {
-    int32 modifier = 0;
-
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-    {
-        if ((*i)->GetMiscValue() == miscValue && (*i)->GetAmount() > modifier)
-            modifier = (*i)->GetAmount();
-    }
-
-    return modifier;
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_MISC_VALUE, miscValue).MaxPositive;
 }
 
 int32 Unit::GetMaxNegativeAuraModifierByMiscValue(AuraType auratype, int32 miscValue) const
 {
-    int32 modifier = 0;
-
-    AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
-    for (AuraEffectList::const_iterator i = mTotalAuraList.begin(); i != mTotalAuraList.end(); ++i)
-    {
-        if ((*i)->GetMiscValue() == miscValue && (*i)->GetAmount() < modifier)
-            modifier = (*i)->GetAmount();
-    }
-
-    return modifier;
+    return GetAuraModifierCache(auratype, AURA_MODIFIER_FILTER_MISC_VALUE, miscValue).MaxNegative;
 }
 
 int32 Unit::GetTotalAuraModifierByAffectMask(AuraType auratype, SpellInfo const* affectedSpell) const
 {
-    std::map<SpellGroup, int32> SameEffectSpellGroup;
+    SameEffectSpellGroupAmounts SameEffectSpellGroup;
     int32 modifier = 0;
 
     AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
@@ -4636,15 +4669,15 @@ int32 Unit::GetTotalAuraModifierByAffectMask(AuraType auratype, SpellInfo const*
                 modifier += (*i)->GetAmount();
     }
 
-    for (std::map<SpellGroup, int32>::const_iterator itr = SameEffectSpellGroup.begin(); itr != SameEffectSpellGroup.end(); ++itr)
-        modifier += itr->second;
+    for (uint32 i = 0; i < SameEffectSpellGroup.size(); ++i)
+        modifier += SameEffectSpellGroup.GetAmount(i);
 
     return modifier;
 }
 
 float Unit::GetTotalAuraMultiplierByAffectMask(AuraType auratype, SpellInfo const* affectedSpell) const
 {
-    std::map<SpellGroup, int32> SameEffectSpellGroup;
+    SameEffectSpellGroupAmounts SameEffectSpellGroup;
     float multiplier = 1.0f;
 
     AuraEffectList const& mTotalAuraList = GetAuraEffectsByType(auratype);
@@ -4655,8 +4688,8 @@ float Unit::GetTotalAuraMultiplierByAffectMask(AuraType auratype, SpellInfo cons
                 AddPct(multiplier, (*i)->GetAmount());
     }
 
-    for (std::map<SpellGroup, int32>::const_iterator itr = SameEffectSpellGroup.begin(); itr != SameEffectSpellGroup.end(); ++itr)
-        AddPct(multiplier, itr->second);
+    for (uint32 i = 0; i < SameEffectSpellGroup.size(); ++i)
+        AddPct(multiplier, SameEffectSpellGroup.GetAmount(i));
 
     return multiplier;
 }
@@ -13488,6 +13521,10 @@ void Unit::RemoveFromWorld()
             }
         }
 
+        // a pending visibility update is dropped by the map, the next one must not wait for it
+        ResetAllNotifies();
+        m_hasVisibilityNotifyPos = false;
+
         WorldObject::RemoveFromWorld();
         m_duringRemoveFromWorld = false;
     }
@@ -14005,6 +14042,13 @@ void Unit::ProcDamageAndSpellFor(bool isVictim, Unit* target, uint32 procFlag, u
         }
     }
 
+    if (m_procAurasGeneration != sSpellMgr->GetSpellProcGeneration())
+        _RebuildProcAuras();
+
+    // no applied aura can be triggered by these proc flags
+    if (!(m_procAuraFlags & procFlag))
+        return;
+
     Unit* actor = isVictim ? target : this;
     Unit* actionTarget = !isVictim ? target : this;
 
@@ -14012,18 +14056,21 @@ void Unit::ProcDamageAndSpellFor(bool isVictim, Unit* target, uint32 procFlag, u
     HealInfo healInfo = HealInfo(actor, actionTarget, damage, procSpell, procSpell ? SpellSchoolMask(procSpell->SchoolMask) : SPELL_SCHOOL_MASK_NORMAL);
     ProcEventInfo eventInfo = ProcEventInfo(actor, actionTarget, target, procFlag, 0, 0, procExtra, NULL, &damageInfo, &healInfo);
 
+    if (isVictim)
+        procExtra &= ~PROC_EX_INTERNAL_REQ_FAMILY;
+
     ProcTriggeredList procTriggered;
-    // Fill procTriggered list
-    for (AuraApplicationMap::const_iterator itr = GetAppliedAuras().begin(); itr!= GetAppliedAuras().end(); ++itr)
+    // Fill procTriggered list, only auras with a matching proc flag can pass IsTriggeredAtSpellProcEvent
+    for (AuraApplicationMap::const_iterator itr = m_procAuras.begin(); itr != m_procAuras.end(); ++itr)
     {
+        if (!(itr->second->GetProcFlags() & procFlag))
+            continue;
         // Do not allow auras to proc from effect triggered by itself
         if (procAura && procAura->Id == itr->first)
             continue;
         ProcTriggeredData triggerData(itr->second->GetBase());
         // Defensive procs are active on absorbs (so absorption effects are not a hindrance)
         bool active = damage || (procExtra & PROC_EX_BLOCK && isVictim);
-        if (isVictim)
-            procExtra &= ~PROC_EX_INTERNAL_REQ_FAMILY;
 
         SpellInfo const* spellProto = itr->second->GetBase()->GetSpellInfo();
 
@@ -16350,7 +16397,14 @@ void Unit::SetPhaseMask(uint32 newPhaseMask, bool update)
 void Unit::UpdateObjectVisibility(bool forced)
 {
     if (!forced)
+    {
+        // already queued, or nothing to notify yet
+        if (isNeedNotify(NOTIFY_VISIBILITY_CHANGED) || !IsInWorld())
+            return;
+
         AddToNotify(NOTIFY_VISIBILITY_CHANGED);
+        GetMap()->AddPendingVisibilityUpdate(GetGUID());
+    }
     else
     {
         WorldObject::UpdateObjectVisibility(true);
@@ -16360,6 +16414,23 @@ void Unit::UpdateObjectVisibility(bool forced)
     }
 }
 
+void Unit::UpdateObjectVisibilityOnRelocation()
+{
+    float limit = World::GetVisibilityRelocationLowerLimit();
+    if (!m_hasVisibilityNotifyPos || GetExactDistSq(&m_visibilityNotifyPos) >= limit * limit)
+    {
+        UpdateObjectVisibility(false);
+        return;
+    }
+
+    // short move, creatures around still have to see it for aggro
+    if (isNeedNotify(NOTIFY_VISIBILITY_CHANGED | NOTIFY_AI_RELOCATION) || !IsInWorld())
+        return;
+
+    AddToNotify(NOTIFY_AI_RELOCATION);
+    GetMap()->AddPendingVisibilityUpdate(GetGUID());
+}
+
 void Unit::KnockbackFrom(float x, float y, float speedXY, float speedZ)
 {
     Player* player = NULL;
@@ -17111,7 +17182,7 @@ void Unit::SendThreatListUpdate()
 {
     if (!getThreatManager().isThreatListEmpty())
     {
-        uint32 count = getThreatManager().getThreatList().size();
+        uint32 count = getThreatManager().getThreatListSize();
 
         //TC_LOG_DEBUG(LOG_FILTER_UNITS, "WORLD: Send SMSG_THREAT_UPDATE Message");
         WorldPacket data(SMSG_THREAT_UPDATE, 8 + count * 8);
@@ -17131,7 +17202,7 @@ void Unit::SendChangeCurrentVictimOpcode(HostileReference* pHostileReference)
 {
     if (!getThreatManager().isThreatListEmpty())
     {
-        uint32 count = getThreatManager().getThreatList().size();
+        uint32 count = getThreatManager().getThreatListSize();
 
         TC_LOG_DEBUG(LOG_FILTER_UNITS, "WORLD: Send SMSG_HIGHEST_THREAT_UPDATE Message");
         WorldPacket data(SMSG_HIGHEST_THREAT_UPDATE, 8 + 8 + count * 8);
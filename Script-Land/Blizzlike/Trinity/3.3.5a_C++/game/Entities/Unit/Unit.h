@@ -21,6 +21,7 @@
 
 #include "DBCStructure.h"
 #include "EventProcessor.h"
+#include "FlatAuraMap.h"
 #include "FollowerReference.h"
 #include "FollowerRefManager.h"
 #include "HostileRefManager.h"
@@ -1237,17 +1238,39 @@ enum PlayerTotemType
 
 struct SpellProcEventEntry;                                 // used only privately
 
+enum AuraModifierFilter
+{
+    AURA_MODIFIER_FILTER_NONE       = 0,
+    AURA_MODIFIER_FILTER_MISC_MASK  = 1,
+    AURA_MODIFIER_FILTER_MISC_VALUE = 2
+};
+
+// distinct (filter, misc) aggregates cached per aura type before the cache of the type is reset
+#define MAX_AURA_MODIFIER_CACHE_ENTRIES 16
+
+// Result of the GetTotal/GetMax*AuraModifier* queries for one aura type and misc filter,
+// all four aggregates are built in one walk over the effects of the type
+struct AuraModifierCacheEntry
+{
+    uint8 Filter;                                           // AuraModifierFilter
+    int32 Misc;                                             // misc mask or misc value, depending on Filter
+    int32 Total;
+    float Multiplier;
+    int32 MaxPositive;
+    int32 MaxNegative;
+};
+
 class Unit : public WorldObject
 {
     public:
         typedef std::set<Unit*> AttackerSet;
         typedef std::set<Unit*> ControlList;
 
-        typedef std::multimap<uint32,  Aura*> AuraMap;
+        typedef FlatAuraMap<Aura> AuraMap;
         typedef std::pair<AuraMap::const_iterator, AuraMap::const_iterator> AuraMapBounds;
         typedef std::pair<AuraMap::iterator, AuraMap::iterator> AuraMapBoundsNonConst;
 
-        typedef std::multimap<uint32,  AuraApplication*> AuraApplicationMap;
+        typedef FlatAuraMap<AuraApplication> AuraApplicationMap;
         typedef std::pair<AuraApplicationMap::const_iterator, AuraApplicationMap::const_iterator> AuraApplicationMapBounds;
         typedef std::pair<AuraApplicationMap::iterator, AuraApplicationMap::iterator> AuraApplicationMapBoundsNonConst;
 
@@ -1702,10 +1725,13 @@ class Unit : public WorldObject
         void _ApplyAura(AuraApplication * aurApp, uint8 effMask);
         void _UnapplyAura(AuraApplicationMap::iterator &i, AuraRemoveMode removeMode);
         void _UnapplyAura(AuraApplication * aurApp, AuraRemoveMode removeMode);
+        void _RegisterProcAura(AuraApplication * aurApp);
+        void _UnregisterProcAura(AuraApplication * aurApp);
         void _RemoveNoStackAuraApplicationsDueToAura(Aura* aura);
         void _RemoveNoStackAurasDueToAura(Aura* aura);
         bool _IsNoStackAuraDueToAura(Aura* appliedAura, Aura* existingAura) const;
         void _RegisterAuraEffect(AuraEffect* aurEff, bool apply);
+        void _InvalidateAuraModifierCache(AuraType type);
 
         // m_ownedAuras container management
         AuraMap      & GetOwnedAuras()       { return m_ownedAuras; }
@@ -1750,7 +1776,14 @@ class Unit : public WorldObject
         void _RemoveAllAuraStatMods();
         void _ApplyAllAuraStatMods();
 
-        AuraEffectList const& GetAuraEffectsByType(AuraType type) const { return m_modAuras[type]; }
+        AuraEffectList const& GetAuraEffectsByType(AuraType type) const
+        {
+            if (AuraEffectList const* list = GetModAuraList(type))
+                return *list;
+
+            static AuraEffectList const emptyList;
+            return emptyList;
+        }
         AuraList      & GetSingleCastAuras()       { return m_scAuras; }
         AuraList const& GetSingleCastAuras() const { return m_scAuras; }
 
@@ -1895,6 +1928,10 @@ class Unit : public WorldObject
         // common function for visibility checks for player/creatures with detection code
         void SetPhaseMask(uint32 newPhaseMask, bool update);// overwrite WorldObject::SetPhaseMask
         void UpdateObjectVisibility(bool forced = true);
+        // like UpdateObjectVisibility(false), but moves below Visibility.RelocationLowerLimit only queue the AI relocation pass
+        void UpdateObjectVisibilityOnRelocation();
+        // called by the map once the pending visibility update of this unit was processed
+        void SetVisibilityNotifyPosition() { m_visibilityNotifyPos.Relocate(this); m_hasVisibilityNotifyPos = true; }
 
         SpellImmuneList m_spellImmune[MAX_SPELL_IMMUNITY];
         uint32 m_lastSanctuaryTime;
@@ -2185,12 +2222,31 @@ class Unit : public WorldObject
         AuraMap::iterator m_auraUpdateIterator;
         uint32 m_removedAurasCount;
 
-        AuraEffectList m_modAuras[TOTAL_AURAS];
+        struct ModAuraSlot
+        {
+            AuraEffectList Effects;
+            std::vector<AuraModifierCacheEntry> ModifierCache;  // emptied whenever Effects or one of their amounts change, filled only outside region jobs
+        };
+
+        // aura type -> effects index; only the types ever applied to the unit get a slot,
+        // m_modAuraSlots holds its position in m_modAuraLists plus one (0 = no slot yet).
+        // Slots are kept once created so references handed out stay valid
+        ModAuraSlot* GetModAuraSlot(AuraType type) const { return m_modAuraSlots[type] ? m_modAuraLists[m_modAuraSlots[type] - 1] : NULL; }
+        AuraEffectList* GetModAuraList(AuraType type) const { ModAuraSlot* slot = GetModAuraSlot(type); return slot ? &slot->Effects : NULL; }
+        AuraEffectList& GetOrCreateModAuraList(AuraType type);
+        // not thread-safe on its own: while the map runs its region jobs the cache is only read, misses are built without being stored
+        AuraModifierCacheEntry GetAuraModifierCache(AuraType type, AuraModifierFilter filter, int32 misc) const;
+        uint16 m_modAuraSlots[TOTAL_AURAS];
+        std::vector<ModAuraSlot*> m_modAuraLists;
         AuraList m_scAuras;                        // casted singlecast auras
         AuraApplicationList m_interruptableAuras;             // auras which have interrupt mask applied on unit
         AuraStateAurasMap m_auraStateAuras;        // Used for improve performance of aura state checks on aura apply/remove
         uint32 m_interruptMask;
 
+        AuraApplicationMap m_procAuras;            // applied auras ProcDamageAndSpellFor can trigger, same order as m_appliedAuras
+        uint32 m_procAuraFlags;                    // all proc flags of m_procAuras, events outside of it can't trigger anything
+        uint32 m_procAurasGeneration;              // sSpellMgr->GetSpellProcGeneration() m_procAuras was built for
+
         float m_auraModifiersGroup[UNIT_MOD_END][MODIFIER_TYPE_END];
         float m_weaponDamage[MAX_ATTACK][2];
         bool m_canModifyStats;
@@ -2221,6 +2277,7 @@ class Unit : public WorldObject
 
         void DisableSpline();
     private:
+        void _RebuildProcAuras();
         bool IsTriggeredAtSpellProcEvent(Unit* victim, Aura* aura, SpellInfo const* procSpell, uint32 procFlag, uint32 procExtra, WeaponAttackType attType, bool isVictim, bool active, SpellProcEventEntry const* & spellProcEvent);
         bool HandleDummyAuraProc(Unit* victim, uint32 damage, AuraEffect* triggeredByAura, SpellInfo const* procSpell, uint32 procFlag, uint32 procEx, uint32 cooldown);
         bool HandleAuraProc(Unit* victim, uint32 damage, Aura* triggeredByAura, SpellInfo const* procSpell, uint32 procFlag, uint32 procEx, uint32 cooldown, bool * handled);
@@ -2264,6 +2321,9 @@ class Unit : public WorldObject
         bool _isWalkingBeforeCharm; // Are we walking before we were charmed?
 
         time_t _lastDamagedTime; // Part of Evade mechanics
+
+        Position m_visibilityNotifyPos;                     // position of the last processed visibility update
+        bool m_hasVisibilityNotifyPos;
 };
 
 namespace Trinity
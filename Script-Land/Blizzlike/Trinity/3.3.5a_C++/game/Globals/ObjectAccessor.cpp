@@ -396,6 +396,8 @@ void ObjectAccessor::RemoveOldCorpses()
 
 void ObjectAccessor::Update(uint32 /*diff*/)
 {
+    // objects bound to a map are sent by Map::SendObjectUpdates on the map update threads,
+    // only items and corpses without a map are left here
     UpdateDataMapType update_players;
 
     while (!i_objects.empty())
@@ -426,8 +428,8 @@ void ObjectAccessor::UnloadAll()
 
 /// Define the static members of HashMapHolder
 
-template <class T> UNORDERED_MAP< uint64, T* > HashMapHolder<T>::m_objectMap;
-template <class T> typename HashMapHolder<T>::LockType HashMapHolder<T>::i_lock;
+template <class T> typename HashMapHolder<T>::MapType HashMapHolder<T>::m_objectMap;
+template <class T> typename HashMapHolder<T>::LockType HashMapHolder<T>::i_lock(HashMapHolder<T>::m_objectMap);
 
 /// Global definitions for the hashmap storage
 
@@ -22,6 +22,7 @@
 #include "Define.h"
 #include <ace/Singleton.h>
 #include <ace/Thread_Mutex.h>
+#include <ace/RW_Thread_Mutex.h>
 #include "UnorderedMap.h"
 
 #include "UpdateData.h"
@@ -41,43 +42,184 @@ class Vehicle;
 class Map;
 class WorldRunnable;
 
+// must be a power of two
+#define HASH_MAP_HOLDER_SHARDS 16
+
+/**
+ * GUID index split in shards, every shard with its own lock.
+ *
+ * Lookups from different map update threads only meet on the same lock when
+ * their GUIDs fall into the same shard. The const_iterator walks all shards
+ * so whole container loops keep working, under HashMapHolder::GetLock().
+ */
+template <class T>
+class ShardedGuidMap
+{
+    public:
+        typedef UNORDERED_MAP<uint64, T*> ShardMap;
+        typedef typename ShardMap::value_type value_type;
+
+        class const_iterator
+        {
+            public:
+                const_iterator() : _map(NULL), _shard(HASH_MAP_HOLDER_SHARDS) { }
+                const_iterator(ShardedGuidMap const* map, uint32 shard) : _map(map), _shard(shard)
+                {
+                    if (_shard < HASH_MAP_HOLDER_SHARDS)
+                    {
+                        _itr = _map->_shards[_shard].objects.begin();
+                        SkipEmptyShards();
+                    }
+                }
+
+                value_type const& operator*() const { return *_itr; }
+                value_type const* operator->() const { return &*_itr; }
+
+                const_iterator& operator++()
+                {
+                    ++_itr;
+                    SkipEmptyShards();
+                    return *this;
+                }
+
+                bool operator==(const_iterator const& right) const
+                {
+                    return _shard == right._shard && (_shard == HASH_MAP_HOLDER_SHARDS || _itr == right._itr);
+                }
+
+                bool operator!=(const_iterator const& right) const { return !(*this == right); }
+
+            private:
+                void SkipEmptyShards()
+                {
+                    while (_itr == _map->_shards[_shard].objects.end())
+                    {
+                        if (++_shard == HASH_MAP_HOLDER_SHARDS)
+                            return;
+
+                        _itr = _map->_shards[_shard].objects.begin();
+                    }
+                }
+
+                ShardedGuidMap const* _map;
+                uint32 _shard;
+                typename ShardMap::const_iterator _itr;
+        };
+
+        static uint32 GetShardIndex(uint64 guid)
+        {
+            // low guids are sequential counters, fold the high part in for entry based guids
+            return uint32(guid ^ (guid >> 32)) & (HASH_MAP_HOLDER_SHARDS - 1);
+        }
+
+        ShardMap& GetShard(uint32 index) { return _shards[index].objects; }
+        ACE_RW_Thread_Mutex& GetShardLock(uint32 index) { return _shards[index].lock; }
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, HASH_MAP_HOLDER_SHARDS); }
+
+        size_t size() const
+        {
+            size_t count = 0;
+            for (uint32 i = 0; i < HASH_MAP_HOLDER_SHARDS; ++i)
+                count += _shards[i].objects.size();
+
+            return count;
+        }
+
+    private:
+        struct Shard
+        {
+            ACE_RW_Thread_Mutex lock;
+            ShardMap objects;
+            char pad[64];                                   // keep neighbour shard locks off the same cache line
+        };
+
+        Shard _shards[HASH_MAP_HOLDER_SHARDS];
+};
+
+/**
+ * Locks all shards of a ShardedGuidMap, in index order, for walking the whole
+ * container. Lookups and inserts only ever hold one shard lock so this can't deadlock.
+ */
+template <class T>
+class ShardedGuidMapLock
+{
+    public:
+        explicit ShardedGuidMapLock(ShardedGuidMap<T>& map) : _map(map) { }
+
+        int acquire_read()
+        {
+            for (uint32 i = 0; i < HASH_MAP_HOLDER_SHARDS; ++i)
+                _map.GetShardLock(i).acquire_read();
+
+            return 0;
+        }
+
+        int acquire_write()
+        {
+            for (uint32 i = 0; i < HASH_MAP_HOLDER_SHARDS; ++i)
+                _map.GetShardLock(i).acquire_write();
+
+            return 0;
+        }
+
+        int acquire() { return acquire_write(); }
+
+        int release()
+        {
+            for (uint32 i = HASH_MAP_HOLDER_SHARDS; i > 0; --i)
+                _map.GetShardLock(i - 1).release();
+
+            return 0;
+        }
+
+    private:
+        ShardedGuidMap<T>& _map;
+};
+
 template <class T>
 class HashMapHolder
 {
     public:
 
-        typedef UNORDERED_MAP<uint64, T*> MapType;
-        typedef ACE_RW_Thread_Mutex LockType;
+        typedef ShardedGuidMap<T> MapType;
+        typedef ShardedGuidMapLock<T> LockType;
 
         static void Insert(T* o)
         {
-            TRINITY_WRITE_GUARD(LockType, i_lock);
-            m_objectMap[o->GetGUID()] = o;
+            uint32 shard = MapType::GetShardIndex(o->GetGUID());
+            TRINITY_WRITE_GUARD(ACE_RW_Thread_Mutex, m_objectMap.GetShardLock(shard));
+            m_objectMap.GetShard(shard)[o->GetGUID()] = o;
         }
 
         static void Remove(T* o)
         {
-            TRINITY_WRITE_GUARD(LockType, i_lock);
-            m_objectMap.erase(o->GetGUID());
+            uint32 shard = MapType::GetShardIndex(o->GetGUID());
+            TRINITY_WRITE_GUARD(ACE_RW_Thread_Mutex, m_objectMap.GetShardLock(shard));
+            m_objectMap.GetShard(shard).erase(o->GetGUID());
         }
 
         static T* Find(uint64 guid)
         {
-            TRINITY_READ_GUARD(LockType, i_lock);
-            typename MapType::iterator itr = m_objectMap.find(guid);
-            return (itr != m_objectMap.end()) ? itr->second : NULL;
+            uint32 shard = MapType::GetShardIndex(guid);
+            TRINITY_READ_GUARD(ACE_RW_Thread_Mutex, m_objectMap.GetShardLock(shard));
+            typename MapType::ShardMap const& objects = m_objectMap.GetShard(shard);
+            typename MapType::ShardMap::const_iterator itr = objects.find(guid);
+            return (itr != objects.end()) ? itr->second : NULL;
         }
 
         static MapType& GetContainer() { return m_objectMap; }
 
+        // locks every shard, only needed for walking the whole container
         static LockType* GetLock() { return &i_lock; }
 
     private:
         //Non instanceable only static
         HashMapHolder() {}
 
-        static LockType i_lock;
         static MapType m_objectMap;
+        static LockType i_lock;
 };
 
 class ObjectAccessor
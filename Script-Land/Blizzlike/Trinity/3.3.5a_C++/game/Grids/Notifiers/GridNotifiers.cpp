@@ -16,6 +16,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "WorldSocket.h"                                    // must be first to make ACE happy with ACE includes in it
 #include "GridNotifiers.h"
 #include "GridNotifiersImpl.h"
 #include "WorldPacket.h"
@@ -37,10 +38,8 @@ void VisibleNotifier::SendToSelf()
     if (Transport* transport = i_player.GetTransport())
         for (Transport::PlayerSet::const_iterator itr = transport->GetPassengers().begin();itr != transport->GetPassengers().end();++itr)
         {
-            if (vis_guids.find((*itr)->GetGUID()) != vis_guids.end())
+            if (vis_guids.erase((*itr)->GetGUID()))
             {
-                vis_guids.erase((*itr)->GetGUID());
-
                 i_player.UpdateVisibilityOf((*itr), i_data, i_visibleNow);
 
                 if (!(*itr)->isNeedNotify(NOTIFY_VISIBILITY_CHANGED))
@@ -127,6 +126,7 @@ void PlayerRelocationNotifier::Visit(PlayerMapType &m)
     for (PlayerMapType::iterator iter = m.begin(); iter != m.end(); ++iter)
     {
         Player* player = iter->GetSource();
+        ++i_checks;
 
         vis_guids.erase(player->GetGUID());
 
@@ -146,6 +146,7 @@ void PlayerRelocationNotifier::Visit(CreatureMapType &m)
     for (CreatureMapType::iterator iter=m.begin(); iter != m.end(); ++iter)
     {
         Creature* c = iter->GetSource();
+        ++i_checks;
 
         vis_guids.erase(c->GetGUID());
 
@@ -161,6 +162,7 @@ void CreatureRelocationNotifier::Visit(PlayerMapType &m)
     for (PlayerMapType::iterator iter = m.begin(); iter != m.end(); ++iter)
     {
         Player* player = iter->GetSource();
+        ++i_checks;
 
         if (!player->m_seer->isNeedNotify(NOTIFY_VISIBILITY_CHANGED))
             player->UpdateVisibilityOf(&i_creature);
@@ -177,6 +179,7 @@ void CreatureRelocationNotifier::Visit(CreatureMapType &m)
     for (CreatureMapType::iterator iter = m.begin(); iter != m.end(); ++iter)
     {
         Creature* c = iter->GetSource();
+        ++i_checks;
         CreatureUnitRelocationWorker(&i_creature, c);
 
         if (!c->isNeedNotify(NOTIFY_VISIBILITY_CHANGED))
@@ -184,50 +187,61 @@ void CreatureRelocationNotifier::Visit(CreatureMapType &m)
     }
 }
 
-void DelayedUnitRelocation::Visit(CreatureMapType &m)
+void DelayedUnitRelocation::Relocate(Unit* unit)
 {
-    for (CreatureMapType::iterator iter = m.begin(); iter != m.end(); ++iter)
+    if (Player* player = unit->ToPlayer())
     {
-        Creature* unit = iter->GetSource();
-        if (!unit->isNeedNotify(NOTIFY_VISIBILITY_CHANGED))
-            continue;
+        if (player->m_seer->isNeedNotify(NOTIFY_VISIBILITY_CHANGED))
+            Relocate(*player);
+    }
+    else if (Creature* creature = unit->ToCreature())
+        Relocate(*creature);
+
+    // players looking through this unit see it move, the ones queued themselves are relocated by their own entry
+    if (unit->HasSharedVision())
+        for (SharedVisionList::const_iterator itr = unit->GetSharedVisionList().begin(); itr != unit->GetSharedVisionList().end(); ++itr)
+            if ((*itr)->m_seer == unit && !(*itr)->isNeedNotify(NOTIFY_VISIBILITY_CHANGED))
+                Relocate(**itr);
+}
+
+void DelayedUnitRelocation::Relocate(Creature &unit)
+{
+    CellCoord pair(Trinity::ComputeCellCoord(unit.GetPositionX(), unit.GetPositionY()));
+    Cell cell(pair);
+    cell.SetNoCreate();
 
-        CreatureRelocationNotifier relocate(*unit);
+    CreatureRelocationNotifier relocate(unit);
 
-        TypeContainerVisitor<CreatureRelocationNotifier, WorldTypeMapContainer > c2world_relocation(relocate);
-        TypeContainerVisitor<CreatureRelocationNotifier, GridTypeMapContainer >  c2grid_relocation(relocate);
+    TypeContainerVisitor<CreatureRelocationNotifier, WorldTypeMapContainer > c2world_relocation(relocate);
+    TypeContainerVisitor<CreatureRelocationNotifier, GridTypeMapContainer >  c2grid_relocation(relocate);
 
-        cell.Visit(p, c2world_relocation, i_map, *unit, i_radius);
-        cell.Visit(p, c2grid_relocation, i_map, *unit, i_radius);
-    }
+    cell.Visit(pair, c2world_relocation, i_map, unit, i_radius);
+    cell.Visit(pair, c2grid_relocation, i_map, unit, i_radius);
+
+    i_checks += relocate.i_checks;
 }
 
-void DelayedUnitRelocation::Visit(PlayerMapType &m)
+void DelayedUnitRelocation::Relocate(Player &player)
 {
-    for (PlayerMapType::iterator iter = m.begin(); iter != m.end(); ++iter)
-    {
-        Player* player = iter->GetSource();
-        WorldObject const* viewPoint = player->m_seer;
+    WorldObject const* viewPoint = player.m_seer;
 
-        if (!viewPoint->isNeedNotify(NOTIFY_VISIBILITY_CHANGED))
-            continue;
+    if (&player != viewPoint && !viewPoint->IsPositionValid())
+        return;
 
-        if (player != viewPoint && !viewPoint->IsPositionValid())
-            continue;
+    CellCoord pair(Trinity::ComputeCellCoord(viewPoint->GetPositionX(), viewPoint->GetPositionY()));
+    Cell cell(pair);
+    //cell.SetNoCreate(); need load cells around viewPoint or player, that's why its commented
 
-        CellCoord pair2(Trinity::ComputeCellCoord(viewPoint->GetPositionX(), viewPoint->GetPositionY()));
-        Cell cell2(pair2);
-        //cell.SetNoCreate(); need load cells around viewPoint or player, that's why its commented
+    PlayerRelocationNotifier relocate(player);
+    TypeContainerVisitor<PlayerRelocationNotifier, WorldTypeMapContainer > c2world_relocation(relocate);
+    TypeContainerVisitor<PlayerRelocationNotifier, GridTypeMapContainer >  c2grid_relocation(relocate);
 
-        PlayerRelocationNotifier relocate(*player);
-        TypeContainerVisitor<PlayerRelocationNotifier, WorldTypeMapContainer > c2world_relocation(relocate);
-        TypeContainerVisitor<PlayerRelocationNotifier, GridTypeMapContainer >  c2grid_relocation(relocate);
+    cell.Visit(pair, c2world_relocation, i_map, *viewPoint, i_radius);
+    cell.Visit(pair, c2grid_relocation, i_map, *viewPoint, i_radius);
 
-        cell2.Visit(pair2, c2world_relocation, i_map, *viewPoint, i_radius);
-        cell2.Visit(pair2, c2grid_relocation, i_map, *viewPoint, i_radius);
+    relocate.SendToSelf();
 
-        relocate.SendToSelf();
-    }
+    i_checks += relocate.i_checks;
 }
 
 void AIRelocationNotifier::Visit(CreatureMapType &m)
@@ -241,6 +255,37 @@ void AIRelocationNotifier::Visit(CreatureMapType &m)
     }
 }
 
+MessageDistDeliverer::~MessageDistDeliverer()
+{
+    delete i_sharedPayload;
+}
+
+void MessageDistDeliverer::SendPacket(Player* player)
+{
+    // never send packet to self
+    if (player == i_source || (team && player->GetTeam() != team) || skipped_receiver == player)
+        return;
+
+    if (!player->HaveAtClient(i_source))
+        return;
+
+    WorldSession* session = player->GetSession();
+    if (!session)
+        return;
+
+    if (i_message->size() < SHARED_PACKET_MIN_SIZE)
+    {
+        session->SendPacket(i_message);
+        return;
+    }
+
+    // copied once on the first recipient, every socket then references the same payload
+    if (!i_sharedPayload)
+        i_sharedPayload = new SharedPacketPayload(*i_message);
+
+    session->SendPacket(*i_sharedPayload);
+}
+
 void MessageDistDeliverer::Visit(PlayerMapType &m)
 {
     for (PlayerMapType::iterator iter = m.begin(); iter != m.end(); ++iter)
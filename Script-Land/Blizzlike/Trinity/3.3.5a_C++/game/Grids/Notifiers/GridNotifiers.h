@@ -34,6 +34,7 @@
 #include "WorldSession.h"
 
 class Player;
+class SharedPacketPayload;
 //class Map;
 
 namespace Trinity
@@ -63,9 +64,10 @@ namespace Trinity
 
     struct PlayerRelocationNotifier : public VisibleNotifier
     {
-        PlayerRelocationNotifier(Player &player) : VisibleNotifier(player) {}
+        uint32 i_checks;                                    // objects visited, for Map visibility stats
+        PlayerRelocationNotifier(Player &player) : VisibleNotifier(player), i_checks(0) {}
 
-        template<class T> void Visit(GridRefManager<T> &m) { VisibleNotifier::Visit(m); }
+        template<class T> void Visit(GridRefManager<T> &m) { i_checks += m.getSize(); VisibleNotifier::Visit(m); }
         void Visit(CreatureMapType &);
         void Visit(PlayerMapType &);
     };
@@ -73,23 +75,23 @@ namespace Trinity
     struct CreatureRelocationNotifier
     {
         Creature &i_creature;
-        CreatureRelocationNotifier(Creature &c) : i_creature(c) {}
+        uint32 i_checks;
+        CreatureRelocationNotifier(Creature &c) : i_creature(c), i_checks(0) {}
         template<class T> void Visit(GridRefManager<T> &) {}
         void Visit(CreatureMapType &);
         void Visit(PlayerMapType &);
     };
 
+    // relocates the units queued by Unit::UpdateObjectVisibility(false), see Map::ProcessRelocationNotifies
     struct DelayedUnitRelocation
     {
         Map &i_map;
-        Cell &cell;
-        CellCoord &p;
         const float i_radius;
-        DelayedUnitRelocation(Cell &c, CellCoord &pair, Map &map, float radius) :
-            i_map(map), cell(c), p(pair), i_radius(radius) {}
-        template<class T> void Visit(GridRefManager<T> &) {}
-        void Visit(CreatureMapType &);
-        void Visit(PlayerMapType   &);
+        uint32 i_checks;
+        DelayedUnitRelocation(Map &map, float radius) : i_map(map), i_radius(radius), i_checks(0) {}
+        void Relocate(Unit* unit);
+        void Relocate(Creature &);
+        void Relocate(Player &);
     };
 
     struct AIRelocationNotifier
@@ -124,33 +126,28 @@ namespace Trinity
     {
         WorldObject* i_source;
         WorldPacket* i_message;
+        SharedPacketPayload* i_sharedPayload;
         uint32 i_phaseMask;
         float i_distSq;
         uint32 team;
         Player const* skipped_receiver;
         MessageDistDeliverer(WorldObject* src, WorldPacket* msg, float dist, bool own_team_only = false, Player const* skipped = NULL)
-            : i_source(src), i_message(msg), i_phaseMask(src->GetPhaseMask()), i_distSq(dist * dist)
+            : i_source(src), i_message(msg), i_sharedPayload(NULL), i_phaseMask(src->GetPhaseMask()), i_distSq(dist * dist)
             , team((own_team_only && src->GetTypeId() == TYPEID_PLAYER) ? ((Player*)src)->GetTeam() : 0)
             , skipped_receiver(skipped)
         {
         }
+        ~MessageDistDeliverer();
         void Visit(PlayerMapType &m);
         void Visit(CreatureMapType &m);
         void Visit(DynamicObjectMapType &m);
         template<class SKIP> void Visit(GridRefManager<SKIP> &) {}
 
-        void SendPacket(Player* player)
-        {
-            // never send packet to self
-            if (player == i_source || (team && player->GetTeam() != team) || skipped_receiver == player)
-                return;
+        void SendPacket(Player* player);
 
-            if (!player->HaveAtClient(i_source))
-                return;
-
-            if (WorldSession* session = player->GetSession())
-                session->SendPacket(i_message);
-        }
+        private:
+            MessageDistDeliverer(MessageDistDeliverer const&);
+            MessageDistDeliverer& operator=(MessageDistDeliverer const&);
     };
 
     struct ObjectUpdater
@@ -207,15 +204,16 @@ namespace Trinity
         template<class NOT_INTERESTED> void Visit(GridRefManager<NOT_INTERESTED> &) {}
     };
 
-    template<class Check>
+    // Container may be any sequence of WorldObject* with push_back (std::vector for the spell target search)
+    template<class Check, class Container = std::list<WorldObject*> >
     struct WorldObjectListSearcher
     {
         uint32 i_mapTypeMask;
         uint32 i_phaseMask;
-        std::list<WorldObject*> &i_objects;
+        Container &i_objects;
         Check& i_check;
 
-        WorldObjectListSearcher(WorldObject const* searcher, std::list<WorldObject*> &objects, Check & check, uint32 mapTypeMask = GRID_MAP_TYPE_MASK_ALL)
+        WorldObjectListSearcher(WorldObject const* searcher, Container &objects, Check & check, uint32 mapTypeMask = GRID_MAP_TYPE_MASK_ALL)
             : i_mapTypeMask(mapTypeMask), i_phaseMask(searcher->GetPhaseMask()), i_objects(objects), i_check(check) {}
 
         void Visit(PlayerMapType &m);
@@ -245,8 +245,8 @@ void Trinity::WorldObjectLastSearcher<Check>::Visit(DynamicObjectMapType &m)
     }
 }
 
-template<class Check>
-void Trinity::WorldObjectListSearcher<Check>::Visit(PlayerMapType &m)
+template<class Check, class Container>
+void Trinity::WorldObjectListSearcher<Check, Container>::Visit(PlayerMapType &m)
 {
     if (!(i_mapTypeMask & GRID_MAP_TYPE_MASK_PLAYER))
         return;
@@ -256,8 +256,8 @@ void Trinity::WorldObjectListSearcher<Check>::Visit(PlayerMapType &m)
             i_objects.push_back(itr->GetSource());
 }
 
-template<class Check>
-void Trinity::WorldObjectListSearcher<Check>::Visit(CreatureMapType &m)
+template<class Check, class Container>
+void Trinity::WorldObjectListSearcher<Check, Container>::Visit(CreatureMapType &m)
 {
     if (!(i_mapTypeMask & GRID_MAP_TYPE_MASK_CREATURE))
         return;
@@ -267,8 +267,8 @@ void Trinity::WorldObjectListSearcher<Check>::Visit(CreatureMapType &m)
             i_objects.push_back(itr->GetSource());
 }
 
-template<class Check>
-void Trinity::WorldObjectListSearcher<Check>::Visit(CorpseMapType &m)
+template<class Check, class Container>
+void Trinity::WorldObjectListSearcher<Check, Container>::Visit(CorpseMapType &m)
 {
     if (!(i_mapTypeMask & GRID_MAP_TYPE_MASK_CORPSE))
         return;
@@ -278,8 +278,8 @@ void Trinity::WorldObjectListSearcher<Check>::Visit(CorpseMapType &m)
             i_objects.push_back(itr->GetSource());
 }
 
-template<class Check>
-void Trinity::WorldObjectListSearcher<Check>::Visit(GameObjectMapType &m)
+template<class Check, class Container>
+void Trinity::WorldObjectListSearcher<Check, Container>::Visit(GameObjectMapType &m)
 {
     if (!(i_mapTypeMask & GRID_MAP_TYPE_MASK_GAMEOBJECT))
         return;
@@ -289,8 +289,8 @@ void Trinity::WorldObjectListSearcher<Check>::Visit(GameObjectMapType &m)
             i_objects.push_back(itr->GetSource());
 }
 
-template<class Check>
-void Trinity::WorldObjectListSearcher<Check>::Visit(DynamicObjectMapType &m)
+template<class Check, class Container>
+void Trinity::WorldObjectListSearcher<Check, Container>::Visit(DynamicObjectMapType &m)
 {
     if (!(i_mapTypeMask & GRID_MAP_TYPE_MASK_DYNAMICOBJECT))
         return;
@@ -28,6 +28,7 @@
 #include "InstanceScript.h"
 #include "MapInstanced.h"
 #include "MapManager.h"
+#include "MapRegionUpdater.h"
 #include "ObjectAccessor.h"
 #include "ObjectMgr.h"
 #include "Pet.h"
@@ -36,6 +37,10 @@
 #include "Vehicle.h"
 #include "VMapFactory.h"
 
+#include <ace/Mem_Map.h>
+
+#include <algorithm>
+
 u_map_magic MapMagic        = { {'M','A','P','S'} };
 u_map_magic MapVersionMagic = { {'v','1','.','3'} };
 u_map_magic MapAreaMagic    = { {'A','R','E','A'} };
@@ -67,6 +72,8 @@ Map::~Map()
         sScriptMgr->DecreaseScheduledScriptCount(m_scriptSchedule.size());
 
     MMAP::MMapFactory::createOrGetMMapManager()->unloadMapInstance(GetId(), i_InstanceId);
+
+    delete _regionUpdater;
 }
 
 bool Map::ExistMap(uint32 mapid, int gx, int gy)
@@ -217,11 +224,11 @@ void Map::DeleteStateMachine()
 }
 
 Map::Map(uint32 id, time_t expiry, uint32 InstanceId, uint8 SpawnMode, Map* _parent):
-_creatureToMoveLock(false), i_mapEntry (sMapStore.LookupEntry(id)), i_spawnMode(SpawnMode), i_InstanceId(InstanceId),
+_creatureToMoveLock(false), _regionUpdater(NULL), _regionUpdating(false), i_mapEntry (sMapStore.LookupEntry(id)), i_spawnMode(SpawnMode), i_InstanceId(InstanceId),
 m_unloadTimer(0), m_VisibleDistance(DEFAULT_VISIBILITY_DISTANCE),
 m_VisibilityNotifyPeriod(DEFAULT_VISIBILITY_NOTIFY_PERIOD),
 m_activeNonPlayersIter(m_activeNonPlayers.end()), i_gridExpiry(expiry),
-i_scriptLock(false)
+_visibilityNotifyTimer(0, irand(0, DEFAULT_VISIBILITY_NOTIFY_PERIOD)), i_scriptLock(false)
 {
     m_parentMap = (_parent ? _parent : this);
     for (unsigned int idx=0; idx < MAX_NUMBER_OF_GRIDS; ++idx)
@@ -237,6 +244,9 @@ i_scriptLock(false)
     //lets initialize visibility distance for map
     Map::InitVisibilityDistance();
 
+    if (sWorld->getBoolConfig(CONFIG_MAP_PARALLEL_REGIONS) && i_mapEntry && i_mapEntry->IsContinent())
+        _regionUpdater = new MapRegionUpdater(*this);
+
     sScriptMgr->OnCreateMap(this);
 }
 
@@ -353,6 +363,7 @@ void Map::EnsureGridCreated_i(const GridCoord &p)
 //Load NGrid and make it active
 void Map::EnsureGridLoadedForActiveObject(const Cell &cell, WorldObject* object)
 {
+    GridLoadGuard guard(_gridLoadLock, _regionUpdating);
     EnsureGridLoaded(cell);
     NGridType *grid = getNGrid(cell.GridX(), cell.GridY());
     ASSERT(grid != NULL);
@@ -369,6 +380,9 @@ void Map::EnsureGridLoadedForActiveObject(const Cell &cell, WorldObject* object)
 //Create NGrid and load the object data in it
 bool Map::EnsureGridLoaded(const Cell &cell)
 {
+    // active objects of region jobs may load grids, one at a time; recursive
+    // because objects loaded with the grid may load the next one
+    GridLoadGuard guard(_gridLoadLock, _regionUpdating);
     EnsureGridCreated(GridCoord(cell.GridX(), cell.GridY()));
     NGridType *grid = getNGrid(cell.GridX(), cell.GridY());
 
@@ -485,6 +499,47 @@ bool Map::IsGridLoaded(const GridCoord &p) const
     return (getNGrid(p.x_coord, p.y_coord) && isGridObjectDataLoaded(p.x_coord, p.y_coord));
 }
 
+void Map::CollectNearbyCellsOf(WorldObject* obj)
+{
+    // Check for valid position
+    if (!obj->IsPositionValid())
+        return;
+
+    CellArea area = Cell::CalculateCellArea(obj->GetPositionX(), obj->GetPositionY(), obj->GetGridActivationRange());
+
+    for (uint32 x = area.low_bound.x_coord; x <= area.high_bound.x_coord; ++x)
+    {
+        for (uint32 y = area.low_bound.y_coord; y <= area.high_bound.y_coord; ++y)
+        {
+            uint32 cell_id = (y * TOTAL_NUMBER_OF_CELLS_PER_MAP) + x;
+            if (isCellMarked(cell_id))
+                continue;
+
+            markCell(cell_id);
+            _regionUpdater->AddCell(cell_id);
+        }
+    }
+}
+
+void Map::UpdateRegionCell(uint32 cellId, uint32 diff)
+{
+    Trinity::ObjectUpdater updater(diff);
+    TypeContainerVisitor<Trinity::ObjectUpdater, GridTypeMapContainer  > grid_object_update(updater);
+    TypeContainerVisitor<Trinity::ObjectUpdater, WorldTypeMapContainer > world_object_update(updater);
+
+    CellCoord pair(cellId % TOTAL_NUMBER_OF_CELLS_PER_MAP, cellId / TOTAL_NUMBER_OF_CELLS_PER_MAP);
+    Cell cell(pair);
+    cell.SetNoCreate();
+    Visit(cell, grid_object_update);
+    Visit(cell, world_object_update);
+}
+
+void Map::HelpRegionUpdate()
+{
+    if (_regionUpdater)
+        _regionUpdater->Help();
+}
+
 void Map::VisitNearbyCellsOf(WorldObject* obj, TypeContainerVisitor<Trinity::ObjectUpdater, GridTypeMapContainer> &gridVisitor, TypeContainerVisitor<Trinity::ObjectUpdater, WorldTypeMapContainer> &worldVisitor)
 {
     // Check for valid position
@@ -538,6 +593,9 @@ void Map::Update(const uint32 t_diff)
     // for pets
     TypeContainerVisitor<Trinity::ObjectUpdater, WorldTypeMapContainer > world_object_update(updater);
 
+    // regions can only be helped by other map update threads
+    bool regionUpdate = _regionUpdater && sMapMgr->GetMapUpdater()->activated();
+
     // the player iterator is stored in the map object
     // to make sure calls to Map::Remove don't invalidate it
     for (m_mapRefIter = m_mapRefManager.begin(); m_mapRefIter != m_mapRefManager.end(); ++m_mapRefIter)
@@ -550,7 +608,10 @@ void Map::Update(const uint32 t_diff)
         // update players at tick
         player->Update(t_diff);
 
-        VisitNearbyCellsOf(player, grid_object_update, world_object_update);
+        if (regionUpdate)
+            CollectNearbyCellsOf(player);
+        else
+            VisitNearbyCellsOf(player, grid_object_update, world_object_update);
     }
 
     // non-player active objects, increasing iterator in the loop in case of object removal
@@ -562,7 +623,20 @@ void Map::Update(const uint32 t_diff)
         if (!obj || !obj->IsInWorld())
             continue;
 
-        VisitNearbyCellsOf(obj, grid_object_update, world_object_update);
+        if (regionUpdate)
+            CollectNearbyCellsOf(obj);
+        else
+            VisitNearbyCellsOf(obj, grid_object_update, world_object_update);
+    }
+
+    if (regionUpdate)
+    {
+        // scripts started by creatures are only queued, they run below in the serial part
+        i_scriptLock = true;
+        _regionUpdating = true;
+        _regionUpdater->Update(t_diff);
+        _regionUpdating = false;
+        i_scriptLock = false;
     }
 
     ///- Process necessary scripts
@@ -579,95 +653,107 @@ void Map::Update(const uint32 t_diff)
         ProcessRelocationNotifies(t_diff);
 
     sScriptMgr->OnMapUpdate(this, t_diff);
+
+    // build and send the update packets here, on the map update thread
+    SendObjectUpdates();
 }
 
-struct ResetNotifier
+void Map::SendObjectUpdates()
 {
-    template<class T>inline void resetNotify(GridRefManager<T> &m)
+    std::set<Object*> objects;
     {
-        for (typename GridRefManager<T>::iterator iter=m.begin(); iter != m.end(); ++iter)
-            iter->GetSource()->ResetAllNotifies();
-    }
-    template<class T> void Visit(GridRefManager<T> &) {}
-    void Visit(CreatureMapType &m) { resetNotify<Creature>(m);}
-    void Visit(PlayerMapType &m) { resetNotify<Player>(m);}
-};
+        SharedGuard guard(_sharedLock, _regionUpdater != NULL);
+        if (_updateObjects.empty())
+            return;
 
-void Map::ProcessRelocationNotifies(const uint32 diff)
-{
-    for (GridRefManager<NGridType>::iterator i = GridRefManager<NGridType>::begin(); i != GridRefManager<NGridType>::end(); ++i)
-    {
-        NGridType *grid = i->GetSource();
+        objects.swap(_updateObjects);
+    }
 
-        if (grid->GetGridState() != GRID_STATE_ACTIVE)
-            continue;
+    UpdateDataMapType update_players;
 
-        grid->getGridInfoRef()->getRelocationTimer().TUpdate(diff);
-        if (!grid->getGridInfoRef()->getRelocationTimer().TPassed())
-            continue;
+    for (std::set<Object*>::const_iterator itr = objects.begin(); itr != objects.end(); ++itr)
+    {
+        Object* obj = *itr;
+        ASSERT(obj && obj->IsInWorld());
+        obj->BuildUpdate(update_players);
+    }
 
-        uint32 gx = grid->getX(), gy = grid->getY();
+    WorldPacket packet;                                     // here we allocate a std::vector with a size of 0x10000
+    for (UpdateDataMapType::iterator iter = update_players.begin(); iter != update_players.end(); ++iter)
+    {
+        iter->second.BuildPacket(&packet);
+        iter->first->GetSession()->SendPacket(&packet);
+        packet.clear();                                     // clean the string
+    }
+}
 
-        CellCoord cell_min(gx*MAX_NUMBER_OF_CELLS, gy*MAX_NUMBER_OF_CELLS);
-        CellCoord cell_max(cell_min.x_coord + MAX_NUMBER_OF_CELLS, cell_min.y_coord+MAX_NUMBER_OF_CELLS);
+void Map::ProcessRelocationNotifies(const uint32 diff)
+{
+    _visibilityNotifyTimer.TUpdate(diff);
+    if (!_visibilityNotifyTimer.TPassed())
+        return;
 
-        for (uint32 x = cell_min.x_coord; x < cell_max.x_coord; ++x)
-        {
-            for (uint32 y = cell_min.y_coord; y < cell_max.y_coord; ++y)
-            {
-                uint32 cell_id = (y * TOTAL_NUMBER_OF_CELLS_PER_MAP) + x;
-                if (!isCellMarked(cell_id))
-                    continue;
+    _visibilityNotifyTimer.TReset(diff, m_VisibilityNotifyPeriod);
 
-                CellCoord pair(x, y);
-                Cell cell(pair);
-                cell.SetNoCreate();
+    std::vector<uint64> pending;
+    {
+        SharedGuard guard(_sharedLock, _regionUpdater != NULL);
+        if (_pendingVisibilityUpdates.empty())
+            return;
 
-                Trinity::DelayedUnitRelocation cell_relocation(cell, pair, *this, MAX_VISIBILITY_DISTANCE);
-                TypeContainerVisitor<Trinity::DelayedUnitRelocation, GridTypeMapContainer  > grid_object_relocation(cell_relocation);
-                TypeContainerVisitor<Trinity::DelayedUnitRelocation, WorldTypeMapContainer > world_object_relocation(cell_relocation);
-                Visit(cell, grid_object_relocation);
-                Visit(cell, world_object_relocation);
-            }
-        }
+        pending.swap(_pendingVisibilityUpdates);
     }
 
-    ResetNotifier reset;
-    TypeContainerVisitor<ResetNotifier, GridTypeMapContainer >  grid_notifier(reset);
-    TypeContainerVisitor<ResetNotifier, WorldTypeMapContainer > world_notifier(reset);
-    for (GridRefManager<NGridType>::iterator i = GridRefManager<NGridType>::begin(); i != GridRefManager<NGridType>::end(); ++i)
-    {
-        NGridType *grid = i->GetSource();
-
-        if (grid->GetGridState() != GRID_STATE_ACTIVE)
-            continue;
+    // a unit that left and re-entered the map meanwhile is queued twice
+    std::sort(pending.begin(), pending.end());
+    pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
 
-        if (!grid->getGridInfoRef()->getRelocationTimer().TPassed())
+    std::vector<Unit*> units;
+    units.reserve(pending.size());
+    uint32 stale = 0;
+    for (std::vector<uint64>::const_iterator itr = pending.begin(); itr != pending.end(); ++itr)
+    {
+        Unit* unit = ObjectAccessor::GetObjectInMap(*itr, this, (Unit*)NULL);
+        if (!unit || !unit->isNeedNotify(NOTIFY_VISIBILITY_CHANGED | NOTIFY_AI_RELOCATION))
+        {
+            ++stale;
             continue;
+        }
 
-        grid->getGridInfoRef()->getRelocationTimer().TReset(diff, m_VisibilityNotifyPeriod);
-
-        uint32 gx = grid->getX(), gy = grid->getY();
-
-        CellCoord cell_min(gx*MAX_NUMBER_OF_CELLS, gy*MAX_NUMBER_OF_CELLS);
-        CellCoord cell_max(cell_min.x_coord + MAX_NUMBER_OF_CELLS, cell_min.y_coord+MAX_NUMBER_OF_CELLS);
+        units.push_back(unit);
+    }
 
-        for (uint32 x = cell_min.x_coord; x < cell_max.x_coord; ++x)
+    Trinity::DelayedUnitRelocation relocation(*this, MAX_VISIBILITY_DISTANCE);
+    for (std::vector<Unit*>::const_iterator itr = units.begin(); itr != units.end(); ++itr)
+    {
+        if ((*itr)->isNeedNotify(NOTIFY_VISIBILITY_CHANGED))
+            relocation.Relocate(*itr);
+        else
         {
-            for (uint32 y = cell_min.y_coord; y < cell_max.y_coord; ++y)
-            {
-                uint32 cell_id = (y * TOTAL_NUMBER_OF_CELLS_PER_MAP) + x;
-                if (!isCellMarked(cell_id))
-                    continue;
-
-                CellCoord pair(x, y);
-                Cell cell(pair);
-                cell.SetNoCreate();
-                Visit(cell, grid_notifier);
-                Visit(cell, world_notifier);
-            }
+            // moved below Visibility.RelocationLowerLimit, only MoveInLineOfSight for nearby creatures
+            Trinity::AIRelocationNotifier notifier(**itr);
+            (*itr)->VisitNearbyObject((*itr)->GetVisibilityRange(), notifier);
         }
     }
+
+    // the notifiers skip the reverse check for units that are still flagged,
+    // so the flags may only be cleared once every queued unit was relocated
+    for (std::vector<Unit*>::const_iterator itr = units.begin(); itr != units.end(); ++itr)
+    {
+        // the limit is measured from the last visibility refresh, not from AI only passes
+        if ((*itr)->isNeedNotify(NOTIFY_VISIBILITY_CHANGED))
+            (*itr)->SetVisibilityNotifyPosition();
+        (*itr)->ResetAllNotifies();
+    }
+
+    TRINITY_GUARD(ACE_Thread_Mutex, _statsLock);
+    ++_visibilityStats.Ticks;
+    _visibilityStats.LastUnits = uint32(units.size());
+    _visibilityStats.LastChecks = relocation.i_checks;
+    _visibilityStats.MaxChecks = std::max(_visibilityStats.MaxChecks, relocation.i_checks);
+    _visibilityStats.TotalUnits += units.size();
+    _visibilityStats.TotalChecks += relocation.i_checks;
+    _visibilityStats.StaleEntries += stale;
 }
 
 void Map::RemovePlayerFromMap(Player* player, bool remove)
@@ -737,7 +823,7 @@ void Map::PlayerRelocation(Player* player, float x, float y, float z, float orie
         AddToGrid(player, new_cell);
     }
 
-    player->UpdateObjectVisibility(false);
+    player->UpdateObjectVisibilityOnRelocation();
 }
 
 void Map::CreatureRelocation(Creature* creature, float x, float y, float z, float ang, bool respawnRelocationOnFail)
@@ -770,7 +856,7 @@ void Map::CreatureRelocation(Creature* creature, float x, float y, float z, floa
         creature->Relocate(x, y, z, ang);
         if (creature->IsVehicle())
             creature->GetVehicleKit()->RelocatePassengers();
-        creature->UpdateObjectVisibility(false);
+        creature->UpdateObjectVisibilityOnRelocation();
         RemoveCreatureFromMoveList(creature);
     }
 
@@ -782,6 +868,7 @@ void Map::AddCreatureToMoveList(Creature* c, float x, float y, float z, float an
     if (_creatureToMoveLock) //can this happen?
         return;
 
+    SharedGuard guard(_sharedLock, _regionUpdater != NULL);
     if (c->_moveState == CREATURE_CELL_MOVE_NONE)
         _creaturesToMove.push_back(c);
     c->SetNewCellPosition(x, y, z, ang);
@@ -821,7 +908,7 @@ void Map::MoveAllCreaturesInMoveList()
             // update pos
             c->Relocate(c->_newPosition);
             //CreatureRelocationNotify(c, new_cell, new_cell.cellCoord());
-            c->UpdateObjectVisibility(false);
+            c->UpdateObjectVisibilityOnRelocation();
         }
         else
         {
@@ -1072,6 +1159,9 @@ GridMap::GridMap()
     _liquidEntry = NULL;
     _liquidFlags = NULL;
     _liquidMap  = NULL;
+    // File data
+    _mappedFile = NULL;
+    _fileData = NULL;
 }
 
 GridMap::~GridMap()
@@ -1084,59 +1174,103 @@ bool GridMap::loadData(char* filename)
     // Unload old data if exist
     unloadData();
 
-    map_fileheader header;
-    // Not return error if file not found
-    FILE* in = fopen(filename, "rb");
-    if (!in)
-        return true;
+    uint8 const* data = NULL;
+    size_t size = 0;
 
-    if (fread(&header, sizeof(header), 1, in) != 1)
+    if (sWorld->getBoolConfig(CONFIG_MAP_FILES_MEMORY_MAPPED))
     {
+        _mappedFile = new ACE_Mem_Map();
+        if (_mappedFile->map(filename, static_cast<size_t>(-1), O_RDONLY, ACE_DEFAULT_FILE_PERMS, PROT_READ, ACE_MAP_SHARED) == 0)
+        {
+            data = static_cast<uint8 const*>(_mappedFile->addr());
+            size = _mappedFile->size();
+
+            // the mapping outlives the descriptor, don't keep one open per loaded grid
+            _mappedFile->close_handle();
+        }
+        else
+        {
+            // missing or empty file, let the plain read below sort it out
+            delete _mappedFile;
+            _mappedFile = NULL;
+        }
+    }
+
+    if (!data)
+    {
+        // Not return error if file not found
+        FILE* in = fopen(filename, "rb");
+        if (!in)
+            return true;
+
+        fseek(in, 0, SEEK_END);
+        long length = ftell(in);
+        fseek(in, 0, SEEK_SET);
+
+        if (length > 0)
+        {
+            _fileData = new uint8[length];
+            if (fread(_fileData, 1, length, in) == size_t(length))
+            {
+                data = _fileData;
+                size = size_t(length);
+            }
+        }
+
         fclose(in);
-        return false;
     }
 
+    map_fileheader header;
+    if (!data || size < sizeof(header))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+
     if (header.mapMagic.asUInt == MapMagic.asUInt && header.versionMagic.asUInt == MapVersionMagic.asUInt)
     {
         // load up area data
-        if (header.areaMapOffset && !loadAreaData(in, header.areaMapOffset, header.areaMapSize))
+        if (header.areaMapOffset && !loadAreaData(data, size, header.areaMapOffset))
         {
             TC_LOG_ERROR(LOG_FILTER_MAPS, "Error loading map area data\n");
-            fclose(in);
             return false;
         }
         // load up height data
-        if (header.heightMapOffset && !loadHeightData(in, header.heightMapOffset, header.heightMapSize))
+        if (header.heightMapOffset && !loadHeightData(data, size, header.heightMapOffset))
         {
             TC_LOG_ERROR(LOG_FILTER_MAPS, "Error loading map height data\n");
-            fclose(in);
             return false;
         }
         // load up liquid data
-        if (header.liquidMapOffset && !loadLiquidData(in, header.liquidMapOffset, header.liquidMapSize))
+        if (header.liquidMapOffset && !loadLiquidData(data, size, header.liquidMapOffset))
         {
             TC_LOG_ERROR(LOG_FILTER_MAPS, "Error loading map liquids data\n");
-            fclose(in);
             return false;
         }
-        fclose(in);
         return true;
     }
 
     TC_LOG_ERROR(LOG_FILTER_MAPS, "Map file '%s' is from an incompatible map version (%.*s %.*s), %.*s %.*s is expected. Please recreate using the mapextractor.",
         filename, 4, header.mapMagic.asChar, 4, header.versionMagic.asChar, 4, MapMagic.asChar, 4, MapVersionMagic.asChar);
-    fclose(in);
     return false;
 }
 
 void GridMap::unloadData()
 {
-    delete[] _areaMap;
-    delete[] m_V9;
-    delete[] m_V8;
-    delete[] _liquidEntry;
-    delete[] _liquidFlags;
-    delete[] _liquidMap;
+    // all arrays point into the file data or into section copies
+    for (std::vector<uint8*>::const_iterator itr = _sectionCopies.begin(); itr != _sectionCopies.end(); ++itr)
+        delete[] *itr;
+    _sectionCopies.clear();
+
+    delete[] _fileData;
+    _fileData = NULL;
+
+    if (_mappedFile)
+    {
+        _mappedFile->close();
+        delete _mappedFile;
+        _mappedFile = NULL;
+    }
+
     _areaMap = NULL;
     m_V9 = NULL;
     m_V8 = NULL;
@@ -1146,61 +1280,86 @@ void GridMap::unloadData()
     _gridGetHeight = &GridMap::getHeightFromFlat;
 }
 
-bool GridMap::loadAreaData(FILE* in, uint32 offset, uint32 /*size*/)
+template<class T>
+T* GridMap::getSection(uint8 const* data, size_t size, size_t offset, size_t count)
+{
+    size_t length = count * sizeof(T);
+    if (offset > size || length > size - offset)
+        return NULL;
+
+    uint8 const* section = data + offset;
+
+    // the extractor does not pad sections, copy the ones that are not aligned for T
+    if (reinterpret_cast<uintptr_t>(section) % sizeof(T))
+    {
+        uint8* copy = new uint8[length];
+        memcpy(copy, section, length);
+        _sectionCopies.push_back(copy);
+        section = copy;
+    }
+
+    // never written to, the mapping is read-only
+    return reinterpret_cast<T*>(const_cast<uint8*>(section));
+}
+
+bool GridMap::loadAreaData(uint8 const* data, size_t size, uint32 offset)
 {
     map_areaHeader header;
-    fseek(in, offset, SEEK_SET);
+    if (offset > size || sizeof(header) > size - offset)
+        return false;
 
-    if (fread(&header, sizeof(header), 1, in) != 1 || header.fourcc != MapAreaMagic.asUInt)
+    memcpy(&header, data + offset, sizeof(header));
+    if (header.fourcc != MapAreaMagic.asUInt)
         return false;
 
     _gridArea = header.gridArea;
     if (!(header.flags & MAP_AREA_NO_AREA))
     {
-        _areaMap = new uint16 [16*16];
-        if (fread(_areaMap, sizeof(uint16), 16*16, in) != 16*16)
+        _areaMap = getSection<uint16>(data, size, offset + sizeof(header), 16*16);
+        if (!_areaMap)
             return false;
     }
     return true;
 }
 
-bool GridMap::loadHeightData(FILE* in, uint32 offset, uint32 /*size*/)
+bool GridMap::loadHeightData(uint8 const* data, size_t size, uint32 offset)
 {
     map_heightHeader header;
-    fseek(in, offset, SEEK_SET);
+    if (offset > size || sizeof(header) > size - offset)
+        return false;
 
-    if (fread(&header, sizeof(header), 1, in) != 1 || header.fourcc != MapHeightMagic.asUInt)
+    memcpy(&header, data + offset, sizeof(header));
+    if (header.fourcc != MapHeightMagic.asUInt)
         return false;
 
+    size_t dataOffset = offset + sizeof(header);
+
     _gridHeight = header.gridHeight;
     if (!(header.flags & MAP_HEIGHT_NO_HEIGHT))
     {
         if ((header.flags & MAP_HEIGHT_AS_INT16))
         {
-            m_uint16_V9 = new uint16 [129*129];
-            m_uint16_V8 = new uint16 [128*128];
-            if (fread(m_uint16_V9, sizeof(uint16), 129*129, in) != 129*129 ||
-                fread(m_uint16_V8, sizeof(uint16), 128*128, in) != 128*128)
+            m_uint16_V9 = getSection<uint16>(data, size, dataOffset, 129*129);
+            m_uint16_V8 = getSection<uint16>(data, size, dataOffset + sizeof(uint16) * 129*129, 128*128);
+            if (!m_uint16_V9 || !m_uint16_V8)
                 return false;
             _gridIntHeightMultiplier = (header.gridMaxHeight - header.gridHeight) / 65535;
             _gridGetHeight = &GridMap::getHeightFromUint16;
         }
         else if ((header.flags & MAP_HEIGHT_AS_INT8))
         {
-            m_uint8_V9 = new uint8 [129*129];
-            m_uint8_V8 = new uint8 [128*128];
-            if (fread(m_uint8_V9, sizeof(uint8), 129*129, in) != 129*129 ||
-                fread(m_uint8_V8, sizeof(uint8), 128*128, in) != 128*128)
+            m_uint8_V9 = getSection<uint8>(data, size, dataOffset, 129*129);
+            m_uint8_V8 = getSection<uint8>(data, size, dataOffset + sizeof(uint8) * 129*129, 128*128);
+            if (!m_uint8_V9 || !m_uint8_V8)
                 return false;
             _gridIntHeightMultiplier = (header.gridMaxHeight - header.gridHeight) / 255;
             _gridGetHeight = &GridMap::getHeightFromUint8;
         }
         else
         {
-            m_V9 = new float [129*129];
-            m_V8 = new float [128*128];
-            if (fread(m_V9, sizeof(float), 129*129, in) != 129*129 ||
-                fread(m_V8, sizeof(float), 128*128, in) != 128*128)
+            m_V9 = getSection<float>(data, size, dataOffset, 129*129);
+            m_V8 = getSection<float>(data, size, dataOffset + sizeof(float) * 129*129, 128*128);
+            if (!m_V9 || !m_V8)
                 return false;
             _gridGetHeight = &GridMap::getHeightFromFloat;
         }
@@ -1210,12 +1369,14 @@ bool GridMap::loadHeightData(FILE* in, uint32 offset, uint32 /*size*/)
     return true;
 }
 
-bool GridMap::loadLiquidData(FILE* in, uint32 offset, uint32 /*size*/)
+bool GridMap::loadLiquidData(uint8 const* data, size_t size, uint32 offset)
 {
     map_liquidHeader header;
-    fseek(in, offset, SEEK_SET);
+    if (offset > size || sizeof(header) > size - offset)
+        return false;
 
-    if (fread(&header, sizeof(header), 1, in) != 1 || header.fourcc != MapLiquidMagic.asUInt)
+    memcpy(&header, data + offset, sizeof(header));
+    if (header.fourcc != MapLiquidMagic.asUInt)
         return false;
 
     _liquidType   = header.liquidType;
@@ -1225,20 +1386,21 @@ bool GridMap::loadLiquidData(FILE* in, uint32 offset, uint32 /*size*/)
     _liquidHeight = header.height;
     _liquidLevel  = header.liquidLevel;
 
+    size_t dataOffset = offset + sizeof(header);
+
     if (!(header.flags & MAP_LIQUID_NO_TYPE))
     {
-        _liquidEntry = new uint16[16*16];
-        if (fread(_liquidEntry, sizeof(uint16), 16*16, in) != 16*16)
-            return false;
-
-        _liquidFlags = new uint8[16*16];
-        if (fread(_liquidFlags, sizeof(uint8), 16*16, in) != 16*16)
+        _liquidEntry = getSection<uint16>(data, size, dataOffset, 16*16);
+        dataOffset += sizeof(uint16) * 16*16;
+        _liquidFlags = getSection<uint8>(data, size, dataOffset, 16*16);
+        dataOffset += sizeof(uint8) * 16*16;
+        if (!_liquidEntry || !_liquidFlags)
             return false;
     }
     if (!(header.flags & MAP_LIQUID_NO_HEIGHT))
     {
-        _liquidMap = new float[uint32(_liquidWidth) * uint32(_liquidHeight)];
-        if (fread(_liquidMap, sizeof(float), _liquidWidth*_liquidHeight, in) != (uint32(_liquidWidth) * uint32(_liquidHeight)))
+        _liquidMap = getSection<float>(data, size, dataOffset, uint32(_liquidWidth) * uint32(_liquidHeight));
+        if (!_liquidMap)
             return false;
     }
     return true;
@@ -1909,8 +2071,11 @@ void Map::GetZoneAndAreaIdByAreaFlag(uint32& zoneid, uint32& areaid, uint16 area
 
 bool Map::isInLineOfSight(float x1, float y1, float z1, float x2, float y2, float z2, uint32 phasemask) const
 {
-    return VMAP::VMapFactory::createOrGetVMapManager()->isInLineOfSight(GetId(), x1, y1, z1, x2, y2, z2)
-        && _dynamicTree.isInLineOfSight(x1, y1, z1, x2, y2, z2, phasemask);
+    if (!VMAP::VMapFactory::createOrGetVMapManager()->isInLineOfSight(GetId(), x1, y1, z1, x2, y2, z2))
+        return false;
+
+    DynamicTreeGuard guard(_dynamicTreeLock, _regionUpdating, true);
+    return _dynamicTree.isInLineOfSight(x1, y1, z1, x2, y2, z2, phasemask);
 }
 
 bool Map::getObjectHitPos(uint32 phasemask, float x1, float y1, float z1, float x2, float y2, float z2, float& rx, float& ry, float& rz, float modifyDist)
@@ -1919,7 +2084,11 @@ bool Map::getObjectHitPos(uint32 phasemask, float x1, float y1, float z1, float
     G3D::Vector3 dstPos(x2, y2, z2);
 
     G3D::Vector3 resultPos;
-    bool result = _dynamicTree.getObjectHitPos(phasemask, startPos, dstPos, resultPos, modifyDist);
+    bool result;
+    {
+        DynamicTreeGuard guard(_dynamicTreeLock, _regionUpdating, true);
+        result = _dynamicTree.getObjectHitPos(phasemask, startPos, dstPos, resultPos, modifyDist);
+    }
 
     rx = resultPos.x;
     ry = resultPos.y;
@@ -1929,7 +2098,10 @@ bool Map::getObjectHitPos(uint32 phasemask, float x1, float y1, float z1, float
 
 float Map::GetHeight(uint32 phasemask, float x, float y, float z, bool vmap/*=true*/, float maxSearchDist/*=DEFAULT_HEIGHT_SEARCH*/) const
 {
-    return std::max<float>(GetHeight(x, y, z, vmap, maxSearchDist), _dynamicTree.getHeight(x, y, z, maxSearchDist, phasemask));
+    float staticHeight = GetHeight(x, y, z, vmap, maxSearchDist);
+
+    DynamicTreeGuard guard(_dynamicTreeLock, _regionUpdating, true);
+    return std::max<float>(staticHeight, _dynamicTree.getHeight(x, y, z, maxSearchDist, phasemask));
 }
 
 bool Map::IsInWater(float x, float y, float pZ, LiquidData* data) const
@@ -2082,6 +2254,9 @@ inline void Map::setNGrid(NGridType *grid, uint32 x, uint32 y)
 
 void Map::DelayedUpdate(const uint32 t_diff)
 {
+    // changes made from the world thread after the map was updated
+    SendObjectUpdates();
+
     RemoveAllObjectsInRemoveList();
 
     // Don't unload grids if it's battleground, since we may have manually added GOs, creatures, those doesn't load from DB at grid re-load !
@@ -2105,6 +2280,7 @@ void Map::AddObjectToRemoveList(WorldObject* obj)
 
     obj->CleanupsBeforeDelete(false);                            // remove or simplify at least cross referenced links
 
+    SharedGuard guard(_sharedLock, _regionUpdater != NULL);
     i_objectsToRemove.insert(obj);
     //TC_LOG_DEBUG(LOG_FILTER_MAPS, "Object (GUID: %u TypeId: %u) added to removing list.", obj->GetGUIDLow(), obj->GetTypeId());
 }
@@ -2113,6 +2289,7 @@ void Map::AddObjectToSwitchList(WorldObject* obj, bool on)
 {
     ASSERT(obj->GetMapId() == GetId() && obj->GetInstanceId() == GetInstanceId());
 
+    SharedGuard guard(_sharedLock, _regionUpdater != NULL);
     std::map<WorldObject*, bool>::iterator itr = i_objectsToSwitch.find(obj);
     if (itr == i_objectsToSwitch.end())
         i_objectsToSwitch.insert(itr, std::make_pair(obj, on));
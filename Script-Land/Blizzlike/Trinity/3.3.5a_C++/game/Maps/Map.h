@@ -21,6 +21,7 @@
 
 #include "Define.h"
 #include <ace/RW_Thread_Mutex.h>
+#include <ace/Recursive_Thread_Mutex.h>
 #include <ace/Thread_Mutex.h>
 
 #include "DBCStructure.h"
@@ -35,6 +36,7 @@
 
 #include <bitset>
 #include <list>
+#include <vector>
 
 class Unit;
 class WorldPacket;
@@ -52,7 +54,9 @@ struct Position;
 class Battleground;
 class MapInstanced;
 class InstanceMap;
+class MapRegionUpdater;
 namespace Trinity { struct ObjectUpdater; }
+class ACE_Mem_Map;
 
 struct ScriptAction
 {
@@ -184,9 +188,16 @@ class GridMap
     uint8 _liquidHeight;
 
 
-    bool loadAreaData(FILE* in, uint32 offset, uint32 size);
-    bool loadHeightData(FILE* in, uint32 offset, uint32 size);
-    bool loadLiquidData(FILE* in, uint32 offset, uint32 size);
+    // the whole .map file, either mapped read-only (shared with other processes
+    // through the page cache) or read into _fileData; the arrays above point into it
+    ACE_Mem_Map* _mappedFile;
+    uint8* _fileData;
+    std::vector<uint8*> _sectionCopies;
+
+    template<class T> T* getSection(uint8 const* data, size_t size, size_t offset, size_t count);
+    bool loadAreaData(uint8 const* data, size_t size, uint32 offset);
+    bool loadHeightData(uint8 const* data, size_t size, uint32 offset);
+    bool loadLiquidData(uint8 const* data, size_t size, uint32 offset);
 
     // Get height functions and pointers
     typedef float (GridMap::*GetHeightPtr) (float x, float y) const;
@@ -242,6 +253,20 @@ enum LevelRequirementVsMode
 
 typedef std::map<uint32/*leaderDBGUID*/, CreatureGroup*>        CreatureGroupHolderType;
 
+// Counters of the relocation notify pass of one map, exported for diagnostics
+struct MapVisibilityStats
+{
+    MapVisibilityStats() : Ticks(0), LastUnits(0), LastChecks(0), MaxChecks(0), TotalUnits(0), TotalChecks(0), StaleEntries(0) { }
+
+    uint32 Ticks;               // notify ticks that had pending units
+    uint32 LastUnits;           // units relocated at the last such tick
+    uint32 LastChecks;          // visibility / AI pair checks done at the last such tick
+    uint32 MaxChecks;
+    uint64 TotalUnits;
+    uint64 TotalChecks;
+    uint64 StaleEntries;        // queued units that left the map before the tick
+};
+
 class Map : public GridRefManager<NGridType>
 {
     friend class MapReference;
@@ -269,6 +294,11 @@ class Map : public GridRefManager<NGridType>
         template<class T> bool AddToMap(T *);
         template<class T> void RemoveFromMap(T *, bool);
 
+        // called by map update threads helping with the region jobs of this map
+        void HelpRegionUpdate();
+        // true while the region jobs run, objects of the map may then be reached from several threads
+        bool IsUpdatingRegions() const { return _regionUpdating; }
+
         void VisitNearbyCellsOf(WorldObject* obj, TypeContainerVisitor<Trinity::ObjectUpdater, GridTypeMapContainer> &gridVisitor, TypeContainerVisitor<Trinity::ObjectUpdater, WorldTypeMapContainer> &worldVisitor);
         virtual void Update(const uint32);
 
@@ -401,8 +431,40 @@ class Map : public GridRefManager<NGridType>
         uint32 GetPlayersCountExceptGMs() const;
         bool ActiveObjectsNearGrid(NGridType const& ngrid) const;
 
-        void AddWorldObject(WorldObject* obj) { i_worldObjects.insert(obj); }
-        void RemoveWorldObject(WorldObject* obj) { i_worldObjects.erase(obj); }
+        void AddWorldObject(WorldObject* obj)
+        {
+            SharedGuard guard(_sharedLock, _regionUpdater != NULL);
+            i_worldObjects.insert(obj);
+        }
+        void RemoveWorldObject(WorldObject* obj)
+        {
+            SharedGuard guard(_sharedLock, _regionUpdater != NULL);
+            i_worldObjects.erase(obj);
+        }
+
+        // objects with pending field changes, sent at the end of the map update
+        void AddUpdateObject(Object* obj)
+        {
+            SharedGuard guard(_sharedLock, _regionUpdater != NULL);
+            _updateObjects.insert(obj);
+        }
+        void RemoveUpdateObject(Object* obj)
+        {
+            SharedGuard guard(_sharedLock, _regionUpdater != NULL);
+            _updateObjects.erase(obj);
+        }
+
+        // units whose visibility changed, processed at the next relocation notify tick
+        void AddPendingVisibilityUpdate(uint64 guid)
+        {
+            SharedGuard guard(_sharedLock, _regionUpdater != NULL);
+            _pendingVisibilityUpdates.push_back(guid);
+        }
+        MapVisibilityStats GetVisibilityStats()
+        {
+            TRINITY_GUARD(ACE_Thread_Mutex, _statsLock);
+            return _visibilityStats;
+        }
 
         void SendToPlayers(WorldPacket const* data) const;
 
@@ -448,10 +510,11 @@ class Map : public GridRefManager<NGridType>
         float GetWaterOrGroundLevel(float x, float y, float z, float* ground = NULL, bool swim = false) const;
         float GetHeight(uint32 phasemask, float x, float y, float z, bool vmap = true, float maxSearchDist = DEFAULT_HEIGHT_SEARCH) const;
         bool isInLineOfSight(float x1, float y1, float z1, float x2, float y2, float z2, uint32 phasemask) const;
-        void Balance() { _dynamicTree.balance(); }
-        void RemoveGameObjectModel(const GameObjectModel& model) { _dynamicTree.remove(model); }
-        void InsertGameObjectModel(const GameObjectModel& model) { _dynamicTree.insert(model); }
-        bool ContainsGameObjectModel(const GameObjectModel& model) const { return _dynamicTree.contains(model);}
+        // gameobjects of region jobs change the tree while other jobs query it
+        void Balance() { DynamicTreeGuard guard(_dynamicTreeLock, _regionUpdating); _dynamicTree.balance(); }
+        void RemoveGameObjectModel(const GameObjectModel& model) { DynamicTreeGuard guard(_dynamicTreeLock, _regionUpdating); _dynamicTree.remove(model); }
+        void InsertGameObjectModel(const GameObjectModel& model) { DynamicTreeGuard guard(_dynamicTreeLock, _regionUpdating); _dynamicTree.insert(model); }
+        bool ContainsGameObjectModel(const GameObjectModel& model) const { DynamicTreeGuard guard(_dynamicTreeLock, _regionUpdating, true); return _dynamicTree.contains(model); }
         bool getObjectHitPos(uint32 phasemask, float x1, float y1, float z1, float x2, float y2, float z2, float& rx, float &ry, float& rz, float modifyDist);
 
         /*
@@ -508,6 +571,48 @@ class Map : public GridRefManager<NGridType>
         bool _creatureToMoveLock;
         std::vector<Creature*> _creaturesToMove;
 
+        // parallel ObjectUpdater pass over grid regions, continents only (MapUpdate.ParallelRegions)
+        friend class MapRegionUpdater;
+        void CollectNearbyCellsOf(WorldObject* obj);
+        void UpdateRegionCell(uint32 cellId, uint32 diff);
+
+        MapRegionUpdater* _regionUpdater;
+        bool _regionUpdating;
+
+        // takes the lock only when enabled, maps without region jobs pay nothing
+        template<class LOCK>
+        class ConditionalGuard
+        {
+            public:
+                ConditionalGuard(LOCK& lock, bool enabled, bool read = false) : _lock(enabled ? &lock : NULL)
+                {
+                    if (_lock)
+                        read ? _lock->acquire_read() : _lock->acquire();
+                }
+
+                ~ConditionalGuard()
+                {
+                    if (_lock)
+                        _lock->release();
+                }
+
+            private:
+                LOCK* _lock;
+        };
+
+        typedef ConditionalGuard<ACE_Thread_Mutex> SharedGuard;
+        typedef ConditionalGuard<ACE_RW_Thread_Mutex> DynamicTreeGuard;
+        typedef ConditionalGuard<ACE_Recursive_Thread_Mutex> GridLoadGuard;
+
+        // guards the map wide containers that objects may touch from region jobs,
+        // only taken on maps with a region updater (MapUpdate.ParallelRegions)
+        ACE_Thread_Mutex _sharedLock;
+        // _dynamicTree and grid loading, only taken while the region jobs run
+        mutable ACE_RW_Thread_Mutex _dynamicTreeLock;
+        ACE_Recursive_Thread_Mutex _gridLoadLock;
+        // the notify counters are read by .debug visibility from the world thread
+        ACE_Thread_Mutex _statsLock;
+
         bool IsGridLoaded(const GridCoord &) const;
         void EnsureGridCreated(const GridCoord &);
         void EnsureGridCreated_i(const GridCoord &);
@@ -579,10 +684,18 @@ class Map : public GridRefManager<NGridType>
         //visibility calculations. Highly optimized for massive calculations
         void ProcessRelocationNotifies(const uint32 diff);
 
+        // only units queued by Unit::UpdateObjectVisibility are relocated, no cell sweep
+        std::vector<uint64> _pendingVisibilityUpdates;
+        PeriodicTimer _visibilityNotifyTimer;
+        MapVisibilityStats _visibilityStats;
+
         bool i_scriptLock;
         std::set<WorldObject*> i_objectsToRemove;
         std::map<WorldObject*, bool> i_objectsToSwitch;
         std::set<WorldObject*> i_worldObjects;
+        std::set<Object*> _updateObjects;
+
+        void SendObjectUpdates();
 
         typedef std::multimap<time_t, ScriptAction> ScriptScheduleMap;
         ScriptScheduleMap m_scriptSchedule;
@@ -597,12 +710,15 @@ class Map : public GridRefManager<NGridType>
         template<class T>
         void AddToActiveHelper(T* obj)
         {
+            SharedGuard guard(_sharedLock, _regionUpdater != NULL);
             m_activeNonPlayers.insert(obj);
         }
 
         template<class T>
         void RemoveFromActiveHelper(T* obj)
         {
+            SharedGuard guard(_sharedLock, _regionUpdater != NULL);
+
             // Map::Update for active object in proccess
             if (m_activeNonPlayersIter != m_activeNonPlayers.end())
             {
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2008-2013 TrinityCore <http://www.trinitycore.org/>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MapRegionUpdater.h"
+#include "Map.h"
+#include "MapManager.h"
+#include "World.h"
+
+#include <ace/Guard_T.h>
+
+#include <algorithm>
+
+static inline uint32 GetRegionColor(uint32 key) { return key >> 16; }
+
+MapRegionUpdater::MapRegionUpdater(Map& map) : _map(map), _jobsDone(_lock), _nextJob(0), _runningJobs(0), _diff(0)
+{
+}
+
+void MapRegionUpdater::AddCell(uint32 cellId)
+{
+    uint32 regionX = (cellId % TOTAL_NUMBER_OF_CELLS_PER_MAP) / MAP_REGION_CELLS;
+    uint32 regionY = (cellId / TOTAL_NUMBER_OF_CELLS_PER_MAP) / MAP_REGION_CELLS;
+    uint32 color = (regionX & 1) | ((regionY & 1) << 1);
+
+    _cells.push_back(RegionCell((color << 16) | (regionY * MAP_REGIONS_PER_SIDE + regionX), cellId));
+}
+
+void MapRegionUpdater::Update(uint32 diff)
+{
+    if (_cells.empty())
+        return;
+
+    // groups cells by color, then by region
+    std::sort(_cells.begin(), _cells.end());
+
+    uint32 threads = sWorld->getIntConfig(CONFIG_NUMTHREADS);
+    std::vector<RegionJob> jobs;
+    size_t itr = 0;
+
+    for (uint32 color = 0; color < MAP_REGION_COLORS; ++color)
+    {
+        jobs.clear();
+        while (itr < _cells.size() && GetRegionColor(_cells[itr].first) == color)
+        {
+            size_t begin = itr;
+            while (itr < _cells.size() && _cells[itr].first == _cells[begin].first)
+                ++itr;
+
+            jobs.push_back(RegionJob(begin, itr));
+        }
+
+        if (jobs.empty())
+            continue;
+
+        {
+            TRINITY_GUARD(ACE_Thread_Mutex, _lock);
+            _jobs.swap(jobs);
+            _nextJob = 0;
+            _diff = diff;
+        }
+
+        // the calling thread works too, so helpers are only an optimization:
+        // if every map update thread is busy the jobs still get done here
+        size_t helpers = std::min<size_t>(_jobs.size() - 1, threads > 1 ? threads - 1 : 0);
+        for (size_t i = 0; i < helpers; ++i)
+            sMapMgr->GetMapUpdater()->schedule_region_update(_map);
+
+        while (ProcessNextJob())
+            ;
+
+        TRINITY_GUARD(ACE_Thread_Mutex, _lock);
+        while (_runningJobs || _nextJob < _jobs.size())
+            _jobsDone.wait();
+
+        // late helpers must not find the finished jobs
+        _jobs.clear();
+        _nextJob = 0;
+    }
+
+    _cells.clear();
+}
+
+void MapRegionUpdater::Help()
+{
+    while (ProcessNextJob())
+        ;
+}
+
+bool MapRegionUpdater::ProcessNextJob()
+{
+    RegionJob job;
+    uint32 diff;
+
+    {
+        TRINITY_GUARD(ACE_Thread_Mutex, _lock);
+        if (_nextJob >= _jobs.size())
+            return false;
+
+        job = _jobs[_nextJob++];
+        diff = _diff;
+        ++_runningJobs;
+    }
+
+    for (size_t i = job.first; i < job.second; ++i)
+        _map.UpdateRegionCell(_cells[i].second, diff);
+
+    TRINITY_GUARD(ACE_Thread_Mutex, _lock);
+    if (!--_runningJobs && _nextJob >= _jobs.size())
+        _jobsDone.broadcast();
+
+    return true;
+}
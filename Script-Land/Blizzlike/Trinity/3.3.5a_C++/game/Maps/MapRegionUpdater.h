@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2008-2013 TrinityCore <http://www.trinitycore.org/>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRINITY_MAP_REGION_UPDATER_H
+#define TRINITY_MAP_REGION_UPDATER_H
+
+#include "Define.h"
+#include "GridDefines.h"
+
+#include <ace/Thread_Mutex.h>
+#include <ace/Condition_Thread_Mutex.h>
+
+#include <vector>
+
+class Map;
+
+// side of a region in grids, two regions of the same color are always one full
+// region apart, which is far beyond visibility and spell ranges
+#define MAP_REGION_GRIDS            2
+#define MAP_REGION_CELLS            (MAP_REGION_GRIDS * MAX_NUMBER_OF_CELLS)
+#define MAP_REGIONS_PER_SIDE        (MAX_NUMBER_OF_GRIDS / MAP_REGION_GRIDS)
+#define MAP_REGION_COLORS           4
+
+/**
+ * Splits the ObjectUpdater pass of a continent into square grid regions.
+ *
+ * Regions are 4-colored in a checkerboard pattern; all regions of one color are
+ * updated in parallel by the map's own update thread and by idle map update
+ * threads, colors are processed one after another. Cross-cell creature moves
+ * and relocation notifies stay deferred to the serial part of Map::Update.
+ */
+class MapRegionUpdater
+{
+    public:
+        explicit MapRegionUpdater(Map& map);
+
+        void AddCell(uint32 cellId);
+        void Update(uint32 diff);
+
+        // called from other map update threads, only processes pending jobs
+        void Help();
+
+    private:
+        typedef std::pair<uint32 /*region key*/, uint32 /*cell id*/> RegionCell;
+        typedef std::pair<size_t, size_t> RegionJob;        // [begin, end) range of _cells
+
+        bool ProcessNextJob();
+
+        Map& _map;
+        std::vector<RegionCell> _cells;
+        std::vector<RegionJob> _jobs;
+
+        ACE_Thread_Mutex _lock;
+        ACE_Condition_Thread_Mutex _jobsDone;
+        size_t _nextJob;
+        size_t _runningJobs;
+        uint32 _diff;
+};
+
+#endif
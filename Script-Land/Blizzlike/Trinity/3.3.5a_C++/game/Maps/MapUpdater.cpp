@@ -2,20 +2,37 @@
 #include "DelayExecutor.h"
 #include "Map.h"
 #include "DatabaseEnv.h"
+#include "Timer.h"
+#include "ObjectDefines.h"
 
 #include <ace/Guard_T.h>
 #include <ace/Method_Request.h>
+#include <ace/OS_NS_Thread.h>
 
-class WDBThreadStartReq1 : public ACE_Method_Request
+#include <algorithm>
+
+// weight of the newest sample in the per-map cost moving average
+#define MAP_UPDATE_COST_SMOOTHING   0.25f
+// cost assumed for maps that were never measured, keeps them ahead of idle instances
+#define MAP_UPDATE_DEFAULT_COST     1.0f
+// cost stats of maps not updated for this long are dropped (unloaded instances)
+#define MAP_UPDATE_STATS_EXPIRE     (5 * MINUTE * IN_MILLISECONDS)
+
+class MapUpdaterThreadStartReq : public ACE_Method_Request
 {
+    private:
+
+        MapUpdater& m_updater;
+
     public:
 
-        WDBThreadStartReq1()
+        MapUpdaterThreadStartReq(MapUpdater& u) : m_updater(u)
         {
         }
 
         virtual int call()
         {
+            m_updater.register_worker();
             return 0;
         }
 };
@@ -34,42 +51,88 @@ class WDBThreadEndReq1 : public ACE_Method_Request
         }
 };
 
+// Does not carry the map itself: every request runs exactly one queued task,
+// picked from the worker's own queue or stolen from another one
 class MapUpdateRequest : public ACE_Method_Request
+{
+    private:
+
+        MapUpdater& m_updater;
+
+    public:
+
+        MapUpdateRequest(MapUpdater& u)
+            : m_updater(u)
+        {
+        }
+
+        virtual int call()
+        {
+            m_updater.run_next();
+            m_updater.update_finished();
+            return 0;
+        }
+};
+
+// Helps a map that runs its ObjectUpdater pass per region, see MapRegionUpdater
+class MapRegionUpdateRequest : public ACE_Method_Request
 {
     private:
 
         Map& m_map;
         MapUpdater& m_updater;
-        ACE_UINT32 m_diff;
 
     public:
 
-        MapUpdateRequest(Map& m, MapUpdater& u, ACE_UINT32 d)
-            : m_map(m), m_updater(u), m_diff(d)
+        MapRegionUpdateRequest(Map& m, MapUpdater& u)
+            : m_map(m), m_updater(u)
         {
         }
 
         virtual int call()
         {
-            m_map.Update (m_diff);
+            m_map.HelpRegionUpdate();
             m_updater.update_finished();
             return 0;
         }
 };
 
+struct MapUpdateTaskCostPred
+{
+    template<class T>
+    bool operator()(T const& left, T const& right) const { return left.cost > right.cost; }
+};
+
+struct MapUpdateCostPairPred
+{
+    bool operator()(std::pair<float, Map*> const& left, std::pair<float, Map*> const& right) const { return left.first > right.first; }
+};
+
+static uint64 MakeMapCostKey(Map const& map)
+{
+    return MAKE_PAIR64(map.GetId(), map.GetInstanceId());
+}
+
 MapUpdater::MapUpdater():
-m_executor(), m_mutex(), m_condition(m_mutex), pending_requests(0)
+m_executor(), m_mutex(), m_condition(m_mutex), pending_requests(0), m_nextTaskId(0), m_registeredWorkers(0), m_lastStatsCleanup(0)
 {
 }
 
 MapUpdater::~MapUpdater()
 {
     deactivate();
+    clear_queues();
 }
 
 int MapUpdater::activate(size_t num_threads)
 {
-    return m_executor.start((int)num_threads, new WDBThreadStartReq1, new WDBThreadEndReq1);
+    clear_queues();
+    m_registeredWorkers = 0;
+
+    for (size_t i = 0; i < num_threads; ++i)
+        m_queues.push_back(new WorkQueue());
+
+    return m_executor.start((int)num_threads, new MapUpdaterThreadStartReq(*this), new WDBThreadEndReq1);
 }
 
 int MapUpdater::deactivate()
@@ -81,23 +144,86 @@ int MapUpdater::deactivate()
 
 int MapUpdater::wait()
 {
-    TRINITY_GUARD(ACE_Thread_Mutex, m_mutex);
+    {
+        TRINITY_GUARD(ACE_Thread_Mutex, m_mutex);
 
-    while (pending_requests > 0)
-        m_condition.wait();
+        while (pending_requests > 0)
+            m_condition.wait();
+    }
+
+    uint32 now = getMSTime();
+    if (getMSTimeDiff(m_lastStatsCleanup, now) > MAP_UPDATE_STATS_EXPIRE)
+    {
+        m_lastStatsCleanup = now;
+
+        TRINITY_GUARD(ACE_Thread_Mutex, m_statsLock);
+        for (CostStatsMap::iterator itr = m_costStats.begin(); itr != m_costStats.end();)
+        {
+            if (getMSTimeDiff(itr->second.LastUpdateTime, now) > MAP_UPDATE_STATS_EXPIRE)
+                m_costStats.erase(itr++);
+            else
+                ++itr;
+        }
+    }
 
     return 0;
 }
 
 int MapUpdater::schedule_update(Map& map, ACE_UINT32 diff)
+{
+    uint32 taskId;
+    {
+        TRINITY_GUARD(ACE_Thread_Mutex, m_mutex);
+        ++pending_requests;
+        taskId = ++m_nextTaskId;
+    }
+
+    // the task must be queued before the request that will consume it
+    push_task(MapUpdateTask(&map, diff, predict_cost(map), taskId));
+
+    if (m_executor.execute(new MapUpdateRequest(*this)) == -1)
+    {
+        ACE_DEBUG((LM_ERROR, ACE_TEXT("(%t) \n"), ACE_TEXT("Failed to schedule Map Update")));
+
+        // take back exactly the task queued above; if a worker already picked it
+        // up the queues now hold one task more than there are requests, so run
+        // the surplus one here instead of leaving it behind for the next tick
+        if (!remove_task(taskId))
+            run_next();
+
+        update_finished();
+        return -1;
+    }
+
+    return 0;
+}
+
+int MapUpdater::schedule_updates(std::vector<Map*>& maps, ACE_UINT32 diff)
+{
+    std::vector<std::pair<float, Map*> > ordered;
+    ordered.reserve(maps.size());
+    for (std::vector<Map*>::const_iterator itr = maps.begin(); itr != maps.end(); ++itr)
+        ordered.push_back(std::make_pair(predict_cost(**itr), *itr));
+
+    std::stable_sort(ordered.begin(), ordered.end(), MapUpdateCostPairPred());
+
+    int result = 0;
+    for (std::vector<std::pair<float, Map*> >::const_iterator itr = ordered.begin(); itr != ordered.end(); ++itr)
+        if (schedule_update(*itr->second, diff) == -1)
+            result = -1;
+
+    return result;
+}
+
+int MapUpdater::schedule_region_update(Map& map)
 {
     TRINITY_GUARD(ACE_Thread_Mutex, m_mutex);
 
     ++pending_requests;
 
-    if (m_executor.execute(new MapUpdateRequest(map, *this, diff)) == -1)
+    if (m_executor.execute(new MapRegionUpdateRequest(map, *this)) == -1)
     {
-        ACE_DEBUG((LM_ERROR, ACE_TEXT("(%t) \n"), ACE_TEXT("Failed to schedule Map Update")));
+        ACE_DEBUG((LM_ERROR, ACE_TEXT("(%t) \n"), ACE_TEXT("Failed to schedule Map region update")));
 
         --pending_requests;
         return -1;
@@ -125,3 +251,170 @@ void MapUpdater::update_finished()
 
     m_condition.broadcast();
 }
+
+void MapUpdater::GetCostStats(std::vector<MapUpdateCostStats>& stats)
+{
+    TRINITY_GUARD(ACE_Thread_Mutex, m_statsLock);
+
+    stats.reserve(stats.size() + m_costStats.size());
+    for (CostStatsMap::const_iterator itr = m_costStats.begin(); itr != m_costStats.end(); ++itr)
+        stats.push_back(itr->second);
+}
+
+void MapUpdater::register_worker()
+{
+    TRINITY_GUARD(ACE_Thread_Mutex, m_mutex);
+
+    if (m_registeredWorkers < int(m_queues.size()))
+        m_workerSlot->index = m_registeredWorkers++;
+}
+
+void MapUpdater::run_next()
+{
+    MapUpdateTask task;
+    if (!take_task(task))
+        return;
+
+    uint32 startTime = getMSTime();
+    task.map->Update(task.diff);
+    record_cost(*task.map, getMSTimeDiff(startTime, getMSTime()));
+}
+
+float MapUpdater::predict_cost(Map const& map)
+{
+    TRINITY_GUARD(ACE_Thread_Mutex, m_statsLock);
+
+    CostStatsMap::const_iterator itr = m_costStats.find(MakeMapCostKey(map));
+    if (itr == m_costStats.end())
+        return MAP_UPDATE_DEFAULT_COST;
+
+    return itr->second.AvgCost;
+}
+
+void MapUpdater::record_cost(Map const& map, uint32 cost)
+{
+    TRINITY_GUARD(ACE_Thread_Mutex, m_statsLock);
+
+    MapUpdateCostStats& stats = m_costStats[MakeMapCostKey(map)];
+    if (!stats.UpdateCount)
+    {
+        stats.MapId = map.GetId();
+        stats.InstanceId = map.GetInstanceId();
+        stats.AvgCost = float(cost);
+    }
+    else
+        stats.AvgCost += (float(cost) - stats.AvgCost) * MAP_UPDATE_COST_SMOOTHING;
+
+    stats.LastCost = cost;
+    stats.MaxCost = std::max(stats.MaxCost, cost);
+    stats.LastUpdateTime = getMSTime();
+    ++stats.UpdateCount;
+}
+
+void MapUpdater::push_task(MapUpdateTask const& task)
+{
+    // pick the queue with the lowest predicted load
+    WorkQueue* target = NULL;
+    float targetLoad = 0.0f;
+    for (WorkQueues::const_iterator itr = m_queues.begin(); itr != m_queues.end(); ++itr)
+    {
+        TRINITY_GUARD(ACE_Thread_Mutex, (*itr)->lock);
+        if (!target || (*itr)->load < targetLoad)
+        {
+            target = *itr;
+            targetLoad = (*itr)->load;
+        }
+    }
+
+    ASSERT(target);
+
+    TRINITY_GUARD(ACE_Thread_Mutex, target->lock);
+    std::deque<MapUpdateTask>& tasks = target->tasks;
+    tasks.insert(std::upper_bound(tasks.begin(), tasks.end(), task, MapUpdateTaskCostPred()), task);
+    target->load += task.cost;
+}
+
+bool MapUpdater::pop_task(size_t queue, MapUpdateTask& task)
+{
+    WorkQueue* workQueue = m_queues[queue];
+
+    TRINITY_GUARD(ACE_Thread_Mutex, workQueue->lock);
+    if (workQueue->tasks.empty())
+        return false;
+
+    // owner and thieves both take the heaviest pending task, a heavy map
+    // waiting behind a busy worker is exactly what bounds the tick
+    task = workQueue->tasks.front();
+    workQueue->tasks.pop_front();
+
+    workQueue->load = workQueue->tasks.empty() ? 0.0f : std::max(0.0f, workQueue->load - task.cost);
+    return true;
+}
+
+bool MapUpdater::take_task(MapUpdateTask& task)
+{
+    if (m_queues.empty())
+        return false;
+
+    int home = m_workerSlot->index;
+    if (home >= 0 && pop_task(size_t(home), task))
+        return true;
+
+    // every request is issued after its task was queued, so a task is always
+    // pending somewhere; it can only slip past us while other workers shuffle
+    // the queues, retry until it is found
+    while (true)
+    {
+        size_t victim = m_queues.size();
+        float victimLoad = -1.0f;
+        for (size_t i = 0; i < m_queues.size(); ++i)
+        {
+            if (int(i) == home)
+                continue;
+
+            TRINITY_GUARD(ACE_Thread_Mutex, m_queues[i]->lock);
+            if (!m_queues[i]->tasks.empty() && m_queues[i]->load > victimLoad)
+            {
+                victim = i;
+                victimLoad = m_queues[i]->load;
+            }
+        }
+
+        if (victim != m_queues.size() && pop_task(victim, task))
+            return true;
+
+        // the home queue may have been refilled meanwhile
+        if (home >= 0 && pop_task(size_t(home), task))
+            return true;
+
+        ACE_OS::thr_yield();
+    }
+}
+
+bool MapUpdater::remove_task(uint32 id)
+{
+    for (WorkQueues::iterator itr = m_queues.begin(); itr != m_queues.end(); ++itr)
+    {
+        TRINITY_GUARD(ACE_Thread_Mutex, (*itr)->lock);
+        std::deque<MapUpdateTask>& tasks = (*itr)->tasks;
+        for (std::deque<MapUpdateTask>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+        {
+            if (task->id == id)
+            {
+                (*itr)->load = std::max(0.0f, (*itr)->load - task->cost);
+                tasks.erase(task);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void MapUpdater::clear_queues()
+{
+    for (WorkQueues::iterator itr = m_queues.begin(); itr != m_queues.end(); ++itr)
+        delete *itr;
+
+    m_queues.clear();
+}
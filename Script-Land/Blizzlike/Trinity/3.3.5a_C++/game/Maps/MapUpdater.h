@@ -3,11 +3,40 @@
 
 #include <ace/Thread_Mutex.h>
 #include <ace/Condition_Thread_Mutex.h>
+#include <ace/TSS_T.h>
 
+#include <deque>
+#include <vector>
+
+#include "Define.h"
+#include "UnorderedMap.h"
 #include "DelayExecutor.h"
 
 class Map;
 
+// Update cost bookkeeping for one map (or instance), exported for diagnostics
+struct MapUpdateCostStats
+{
+    MapUpdateCostStats() : MapId(0), InstanceId(0), AvgCost(0.0f), LastCost(0), MaxCost(0), UpdateCount(0), LastUpdateTime(0) { }
+
+    uint32 MapId;
+    uint32 InstanceId;
+    float AvgCost;              // exponential moving average of the update time, in ms
+    uint32 LastCost;
+    uint32 MaxCost;
+    uint32 UpdateCount;
+    uint32 LastUpdateTime;      // getMSTime() of the last finished update
+};
+
+/**
+ * Map update scheduler.
+ *
+ * Every worker thread owns a queue of pending map updates kept ordered by
+ * predicted cost (heaviest first). New updates go to the queue with the lowest
+ * predicted load, a worker drains its own queue from the front and, once it
+ * runs dry, steals the heaviest pending update from the most loaded queue.
+ * This keeps the heavy continents from being scheduled last and bounding the tick.
+ */
 class MapUpdater
 {
     public:
@@ -16,8 +45,14 @@ class MapUpdater
         virtual ~MapUpdater();
 
         friend class MapUpdateRequest;
+        friend class MapRegionUpdateRequest;
+        friend class MapUpdaterThreadStartReq;
 
         int schedule_update(Map& map, ACE_UINT32 diff);
+        // schedules a batch of maps, heaviest predicted cost first
+        int schedule_updates(std::vector<Map*>& maps, ACE_UINT32 diff);
+        // asks an idle thread to help with the region jobs of a map being updated
+        int schedule_region_update(Map& map);
 
         int wait();
 
@@ -27,14 +62,66 @@ class MapUpdater
 
         bool activated();
 
+        void GetCostStats(std::vector<MapUpdateCostStats>& stats);
+
     private:
 
+        struct MapUpdateTask
+        {
+            MapUpdateTask() : map(NULL), diff(0), cost(0.0f), id(0) { }
+            MapUpdateTask(Map* m, uint32 d, float c, uint32 i) : map(m), diff(d), cost(c), id(i) { }
+
+            Map* map;
+            uint32 diff;
+            float cost;
+            uint32 id;                                      // unique per scheduled update, a map may be queued more than once
+        };
+
+        struct WorkQueue
+        {
+            WorkQueue() : load(0.0f) { }
+
+            ACE_Thread_Mutex lock;
+            std::deque<MapUpdateTask> tasks;
+            float load;                                     // sum of predicted cost of queued tasks
+        };
+
+        struct WorkerSlot
+        {
+            WorkerSlot() : index(-1) { }
+
+            int index;
+        };
+
+        typedef std::vector<WorkQueue*> WorkQueues;
+        typedef UNORDERED_MAP<uint64, MapUpdateCostStats> CostStatsMap;
+
         DelayExecutor m_executor;
         ACE_Thread_Mutex m_mutex;
         ACE_Condition_Thread_Mutex m_condition;
         size_t pending_requests;
+        uint32 m_nextTaskId;
+
+        WorkQueues m_queues;
+        ACE_TSS<WorkerSlot> m_workerSlot;
+        int m_registeredWorkers;
+
+        ACE_Thread_Mutex m_statsLock;
+        CostStatsMap m_costStats;
+        uint32 m_lastStatsCleanup;
 
         void update_finished();
+        void register_worker();
+        void run_next();
+
+        float predict_cost(Map const& map);
+        void record_cost(Map const& map, uint32 cost);
+
+        void push_task(MapUpdateTask const& task);
+        bool pop_task(size_t queue, MapUpdateTask& task);
+        bool take_task(MapUpdateTask& task);
+        bool remove_task(uint32 id);
+        void clear_queues();
 };
 
 #endif //_MAP_UPDATER_H_INCLUDED
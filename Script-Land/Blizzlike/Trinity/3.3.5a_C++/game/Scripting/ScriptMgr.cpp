@@ -32,6 +32,7 @@
 #include "CreatureAI.h"
 #include "Player.h"
 #include "WorldPacket.h"
+#include "Opcodes.h"
 
 // This is the global static registry of scripts.
 template<class TScript>
@@ -181,6 +182,7 @@ void ScriptMgr::Initialize()
 
     FillSpellSummary();
     AddScripts();
+    BuildPacketHooks();
 
     TC_LOG_INFO(LOG_FILTER_SERVER_LOADING, ">> Loaded %u C++ scripts in %u ms", GetScriptCount(), GetMSTimeDiffToNow(oldMSTime));
 }
@@ -220,6 +222,29 @@ void ScriptMgr::Unload()
     SCR_CLEAR(UnitScript);
 
     #undef SCR_CLEAR
+
+    _packetHooks.clear();
+}
+
+void ScriptMgr::BuildPacketHooks()
+{
+    _packetHooks.clear();
+    _packetHooks.resize(NUM_MSG_TYPES);
+
+    uint32 count = 0;
+    for (SCR_REG_ITR(ServerScript) itr = SCR_REG_LST(ServerScript).begin(); itr != SCR_REG_LST(ServerScript).end(); ++itr)
+    {
+        for (uint16 opcode = 0; opcode < NUM_MSG_TYPES; ++opcode)
+        {
+            if (itr->second->IsSubscribedToPacket(opcode))
+            {
+                _packetHooks[opcode].push_back(itr->second);
+                ++count;
+            }
+        }
+    }
+
+    TC_LOG_INFO(LOG_FILTER_SERVER_LOADING, ">> Registered %u opcode subscriptions of server scripts", count);
 }
 
 void ScriptMgr::LoadDatabase()
@@ -399,21 +424,41 @@ void ScriptMgr::OnSocketClose(WorldSocket* socket, bool wasNew)
     FOREACH_SCRIPT(ServerScript)->OnSocketClose(socket, wasNew);
 }
 
-void ScriptMgr::OnPacketReceive(WorldSocket* socket, WorldPacket packet)
+void ScriptMgr::OnPacketReceive(WorldSocket* socket, WorldPacket const& packet)
 {
     ASSERT(socket);
 
-    FOREACH_SCRIPT(ServerScript)->OnPacketReceive(socket, packet);
+    if (packet.GetOpcode() >= _packetHooks.size())
+        return;
+
+    PacketHookList const& hooks = _packetHooks[packet.GetOpcode()];
+    if (hooks.empty())
+        return;
+
+    // scripts get a copy they may modify, made only when someone listens
+    WorldPacket copy(packet);
+    for (PacketHookList::const_iterator itr = hooks.begin(); itr != hooks.end(); ++itr)
+        (*itr)->OnPacketReceive(socket, copy);
 }
 
-void ScriptMgr::OnPacketSend(WorldSocket* socket, WorldPacket packet)
+void ScriptMgr::OnPacketSend(WorldSocket* socket, WorldPacket const& packet)
 {
     ASSERT(socket);
 
-    FOREACH_SCRIPT(ServerScript)->OnPacketSend(socket, packet);
+    if (packet.GetOpcode() >= _packetHooks.size())
+        return;
+
+    PacketHookList const& hooks = _packetHooks[packet.GetOpcode()];
+    if (hooks.empty())
+        return;
+
+    // scripts get a copy they may modify, made only when someone listens
+    WorldPacket copy(packet);
+    for (PacketHookList::const_iterator itr = hooks.begin(); itr != hooks.end(); ++itr)
+        (*itr)->OnPacketSend(socket, copy);
 }
 
-void ScriptMgr::OnUnknownPacketReceive(WorldSocket* socket, WorldPacket packet)
+void ScriptMgr::OnUnknownPacketReceive(WorldSocket* socket, WorldPacket& packet)
 {
     ASSERT(socket);
 
@@ -1374,6 +1419,11 @@ ServerScript::ServerScript(const char* name)
     ScriptRegistry<ServerScript>::AddScript(this);
 }
 
+bool ServerScript::IsSubscribedToPacket(uint16 opcode) const
+{
+    return _packetOpcodes.empty() || std::find(_packetOpcodes.begin(), _packetOpcodes.end(), opcode) != _packetOpcodes.end();
+}
+
 WorldScript::WorldScript(const char* name)
     : ScriptObject(name)
 {
@@ -236,6 +236,18 @@ class ServerScript : public ScriptObject
         // Called when an invalid (unknown opcode) packet is received by a client. The packet is a reference to the orignal
         // packet; not a copy. This allows you to actually handle unknown packets (for whatever purpose).
         virtual void OnUnknownPacketReceive(WorldSocket* /*socket*/, WorldPacket& /*packet*/) { }
+
+        bool IsSubscribedToPacket(uint16 opcode) const;
+
+    protected:
+
+        // Narrows OnPacketSend/OnPacketReceive to the given opcodes, call it from the constructor.
+        // Scripts that never subscribe get every packet; opcodes no script wants are not copied at all.
+        void SubscribeToPacket(uint16 opcode) { _packetOpcodes.push_back(opcode); }
+
+    private:
+
+        std::vector<uint16> _packetOpcodes;
 };
 
 class WorldScript : public ScriptObject
@@ -869,9 +881,9 @@ class ScriptMgr
         void OnNetworkStop();
         void OnSocketOpen(WorldSocket* socket);
         void OnSocketClose(WorldSocket* socket, bool wasNew);
-        void OnPacketReceive(WorldSocket* socket, WorldPacket packet);
-        void OnPacketSend(WorldSocket* socket, WorldPacket packet);
-        void OnUnknownPacketReceive(WorldSocket* socket, WorldPacket packet);
+        void OnPacketReceive(WorldSocket* socket, WorldPacket const& packet);
+        void OnPacketSend(WorldSocket* socket, WorldPacket const& packet);
+        void OnUnknownPacketReceive(WorldSocket* socket, WorldPacket& packet);
 
     public: /* WorldScript */
 
@@ -1070,8 +1082,14 @@ class ScriptMgr
 
     private:
 
+        void BuildPacketHooks();
+
         uint32 _scriptCount;
 
+        // ServerScripts subscribed to each opcode, built once all scripts are loaded
+        typedef std::vector<ServerScript*> PacketHookList;
+        std::vector<PacketHookList> _packetHooks;
+
         //atomic op counter for active scripts amount
         ACE_Atomic_Op<ACE_Thread_Mutex, long> _scheduledScripts;
 };
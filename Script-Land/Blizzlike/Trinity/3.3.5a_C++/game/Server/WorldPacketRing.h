@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2008-2013 TrinityCore <http://www.trinitycore.org/>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WORLDPACKETRING_H
+#define __WORLDPACKETRING_H
+
+#include "Define.h"
+#include "CompilerDefs.h"
+#include "Errors.h"
+
+#if COMPILER == COMPILER_MICROSOFT
+#  include <windows.h>
+#  define WORLD_PACKET_RING_CAS(ptr, expected, desired) (InterlockedCompareExchange((ptr), (desired), (expected)) == (expected))
+#  define WORLD_PACKET_RING_BARRIER() MemoryBarrier()
+#else
+#  define WORLD_PACKET_RING_CAS(ptr, expected, desired) __sync_bool_compare_and_swap((ptr), (expected), (desired))
+#  define WORLD_PACKET_RING_BARRIER() __sync_synchronize()
+#endif
+
+/**
+ * Bounded lock-free multi-producer / single-consumer ring of pointers.
+ *
+ * Every cell carries a sequence number telling whether it is free for the
+ * producer at a given position or holds an element for the consumer at that
+ * position. Producers reserve a position with one CAS on the tail, the consumer
+ * never writes anything the producers compare against except the cell sequence.
+ * Peek/Pop must only be called from one thread at a time; callers that take
+ * turns (map thread, then world thread) must be ordered by a lock or barrier.
+ */
+template<class T, uint32 Size>
+class WorldPacketRing
+{
+    public:
+        WorldPacketRing() : _head(0), _tail(0)
+        {
+            // a power of two keeps the position to cell mapping a mask
+            ASSERT(Size && !(Size & (Size - 1)));
+
+            for (uint32 i = 0; i < Size; ++i)
+            {
+                _cells[i].sequence = long(i);
+                _cells[i].value = NULL;
+            }
+        }
+
+        /// Producer side, returns false when the ring is full.
+        bool Enqueue(T* value)
+        {
+            Cell* cell;
+            long pos = _tail;
+            while (true)
+            {
+                cell = &_cells[pos & (Size - 1)];
+                long seq = cell->sequence;
+                WORLD_PACKET_RING_BARRIER();
+
+                long dif = seq - pos;
+                if (dif == 0)
+                {
+                    if (WORLD_PACKET_RING_CAS(&_tail, pos, pos + 1))
+                        break;
+                }
+                else if (dif < 0)
+                    return false;
+
+                pos = _tail;
+            }
+
+            cell->value = value;
+            WORLD_PACKET_RING_BARRIER();
+            cell->sequence = pos + 1;
+            return true;
+        }
+
+        /// Consumer side, the oldest element or NULL if there is none (yet).
+        T* Peek() const
+        {
+            Cell const& cell = _cells[_head & (Size - 1)];
+            long seq = cell.sequence;
+            WORLD_PACKET_RING_BARRIER();
+
+            // a producer may have reserved the cell without publishing it yet
+            if (seq != _head + 1)
+                return NULL;
+
+            return cell.value;
+        }
+
+        /// Consumer side, drops the element returned by Peek().
+        void Pop()
+        {
+            Cell& cell = _cells[_head & (Size - 1)];
+            cell.value = NULL;
+            WORLD_PACKET_RING_BARRIER();
+            cell.sequence = _head + long(Size);
+            ++_head;
+        }
+
+        /// Consumer side.
+        T* Dequeue()
+        {
+            T* value = Peek();
+            if (value)
+                Pop();
+
+            return value;
+        }
+
+    private:
+        WorldPacketRing(WorldPacketRing const&);
+        WorldPacketRing& operator=(WorldPacketRing const&);
+
+        struct Cell
+        {
+            long volatile sequence;
+            T* value;
+        };
+
+        Cell _cells[Size];
+        long _head;                                         // only touched by the consumer
+        long volatile _tail;
+};
+
+#endif
@@ -117,8 +117,11 @@ WorldSession::WorldSession(uint32 id, WorldSocket* sock, AccountTypes sec, uint8
     m_TutorialsChanged(false),
     recruiterId(recruiter),
     isRecruiter(isARecruiter),
+    _recvOverflowSize(0),
+    _recvPeekedOverflow(false),
     timeLastWhoCommand(0),
-    _RBACData(NULL)
+    _RBACData(NULL),
+    _opcodeRateWindowStart(getMSTime())
 {
     if (sock)
     {
@@ -149,9 +152,14 @@ WorldSession::~WorldSession()
     delete _warden;
     delete _RBACData;
 
-    ///- empty incoming packet queue
-    WorldPacket* packet = NULL;
-    while (_recvQueue.next(packet))
+    ///- empty incoming packet queue and the packet pool
+    while (WorldPacket* packet = _recvQueue.Dequeue())
+        delete packet;
+
+    for (std::deque<WorldPacket*>::const_iterator itr = _recvOverflow.begin(); itr != _recvOverflow.end(); ++itr)
+        delete *itr;
+
+    while (WorldPacket* packet = _freePackets.Dequeue())
         delete packet;
 
     LoginDatabase.PExecute("UPDATE account SET online = 0 WHERE id = %u;", GetAccountId());     // One-time query
@@ -223,10 +231,103 @@ void WorldSession::SendPacket(WorldPacket const* packet)
         m_Socket->CloseSocket();
 }
 
-/// Add an incoming packet to the queue
-void WorldSession::QueuePacket(WorldPacket* new_packet)
+/// Send a packet broadcast to several sessions, the payload is not copied again
+void WorldSession::SendPacket(SharedPacketPayload const& payload)
 {
-    _recvQueue.add(new_packet);
+    if (!m_Socket)
+        return;
+
+    if (m_Socket->SendPacket(payload) == -1)
+        m_Socket->CloseSocket();
+}
+
+/// Add an incoming packet to the queue, fails when the client sends much faster than it is served
+bool WorldSession::QueuePacket(WorldPacket* new_packet)
+{
+    // once packets overflowed, newer ones must queue behind them until the list is drained
+    if (!_recvOverflowSize && _recvQueue.Enqueue(new_packet))
+        return true;
+
+    TRINITY_GUARD(ACE_Thread_Mutex, _recvOverflowLock);
+
+    uint32 limit = sWorld->getIntConfig(CONFIG_SESSION_RECV_QUEUE_LIMIT);
+    if (limit && _recvOverflow.size() >= limit)
+        return false;
+
+    if (_recvOverflow.empty())
+        TC_LOG_DEBUG(LOG_FILTER_NETWORKIO, "WorldSession::QueuePacket: receive ring of %s is full, queueing in the overflow list", GetPlayerInfo().c_str());
+
+    _recvOverflow.push_back(new_packet);
+    _recvOverflowSize = long(_recvOverflow.size());
+    return true;
+}
+
+WorldPacket* WorldSession::PeekRecvPacket()
+{
+    _recvPeekedOverflow = false;
+    if (WorldPacket* packet = _recvQueue.Peek())
+        return packet;
+
+    if (!_recvOverflowSize)
+        return NULL;
+
+    TRINITY_GUARD(ACE_Thread_Mutex, _recvOverflowLock);
+    if (_recvOverflow.empty())
+        return NULL;
+
+    _recvPeekedOverflow = true;
+    return _recvOverflow.front();
+}
+
+void WorldSession::PopRecvPacket()
+{
+    if (!_recvPeekedOverflow)
+    {
+        _recvQueue.Pop();
+        return;
+    }
+
+    TRINITY_GUARD(ACE_Thread_Mutex, _recvOverflowLock);
+    _recvOverflow.pop_front();
+    _recvOverflowSize = long(_recvOverflow.size());
+    _recvPeekedOverflow = false;
+}
+
+/// Get a packet from the pool of processed ones, or a new one if it is empty
+WorldPacket* WorldSession::AllocateRecvPacket(uint16 opcode, size_t size)
+{
+    if (WorldPacket* packet = _freePackets.Dequeue())
+    {
+        packet->Initialize(opcode, size);
+        return packet;
+    }
+
+    return new WorldPacket(opcode, size);
+}
+
+void WorldSession::RecyclePacket(WorldPacket* packet)
+{
+    if (packet->size() > SESSION_PACKET_POOL_MAX_SIZE || !_freePackets.Enqueue(packet))
+        delete packet;
+}
+
+void WorldSession::AccountOpcode(uint16 opcode)
+{
+    uint32 limit = sWorld->getIntConfig(CONFIG_OPCODE_RATE_WARNING);
+    if (!limit)
+        return;
+
+    uint32 now = getMSTime();
+    if (getMSTimeDiff(_opcodeRateWindowStart, now) >= IN_MILLISECONDS)
+    {
+        _opcodeRates.clear();
+        _opcodeRateWindowStart = now;
+    }
+
+    // reported once per window
+    if (++_opcodeRates[opcode] == limit)
+        TC_LOG_WARN(LOG_FILTER_NETWORKIO, "WorldSession: %s sent opcode %s %u times within a second",
+            GetPlayerInfo().c_str(), GetOpcodeNameForLogging(opcode).c_str(), limit);
 }
 
 /// Logging helper for unexpected opcodes
@@ -261,8 +362,6 @@ bool WorldSession::Update(uint32 diff, PacketFilter& updater)
     ///- Retrieve packets from the receive queue and call the appropriate handlers
     /// not process packets if socket already closed
     WorldPacket* packet = NULL;
-    //! Delete packet after processing by default
-    bool deletePacket = true;
     //! To prevent infinite loop
     WorldPacket* firstDelayedPacket = NULL;
     //! If _recvQueue.peek() == firstDelayedPacket it means that in this Update call, we've processed all
@@ -271,14 +370,19 @@ bool WorldSession::Update(uint32 diff, PacketFilter& updater)
     //! loop caused by re-enqueueing the same packets over and over again, we stop updating this session
     //! and continue updating others. The re-enqueued packets will be handled in the next Update call for this session.
     while (m_Socket && !m_Socket->IsClosed() &&
-            !_recvQueue.empty() && _recvQueue.peek(true) != firstDelayedPacket &&
-            _recvQueue.next(packet, updater))
+            (packet = PeekRecvPacket()) != NULL && packet != firstDelayedPacket &&
+            updater.Process(packet))
     {
+        PopRecvPacket();
+
+        //! Recycle packet after processing by default
+        bool deletePacket = true;
+
         if (packet->GetOpcode() >= NUM_MSG_TYPES)
         {
             TC_LOG_ERROR(LOG_FILTER_OPCODES, "Received non-existed opcode %s from %s", GetOpcodeNameForLogging(packet->GetOpcode()).c_str()
                             , GetPlayerInfo().c_str());
-            sScriptMgr->OnUnknownPacketReceive(m_Socket, WorldPacket(*packet));
+            sScriptMgr->OnUnknownPacketReceive(m_Socket, *packet);
         }
         else
         {
@@ -300,15 +404,24 @@ bool WorldSession::Update(uint32 diff, PacketFilter& updater)
                                     firstDelayedPacket = packet;
                                 //! Because checking a bool is faster than reallocating memory
                                 deletePacket = false;
-                                QueuePacket(packet);
                                 //! Log
                                 TC_LOG_DEBUG(LOG_FILTER_NETWORKIO, "Re-enqueueing packet with opcode %s with with status STATUS_LOGGEDIN. "
                                     "Player is currently not in world yet.", GetOpcodeNameForLogging(packet->GetOpcode()).c_str());
+                                if (!QueuePacket(packet))
+                                {
+                                    //! Same as the network thread does with a full queue
+                                    TC_LOG_ERROR(LOG_FILTER_NETWORKIO, "WorldSession::Update: receive queue of %s is full, dropping delayed opcode %s and disconnecting",
+                                        GetPlayerInfo().c_str(), GetOpcodeNameForLogging(packet->GetOpcode()).c_str());
+                                    if (firstDelayedPacket == packet)
+                                        firstDelayedPacket = NULL;
+                                    delete packet;
+                                    m_Socket->CloseSocket();
+                                }
                             }
                         }
                         else if (_player->IsInWorld())
                         {
-                            sScriptMgr->OnPacketReceive(m_Socket, WorldPacket(*packet));
+                            sScriptMgr->OnPacketReceive(m_Socket, *packet);
                             (this->*opHandle.handler)(*packet);
                             LogUnprocessedTail(packet);
                         }
@@ -321,7 +434,7 @@ bool WorldSession::Update(uint32 diff, PacketFilter& updater)
                         else
                         {
                             // not expected _player or must checked in packet handler
-                            sScriptMgr->OnPacketReceive(m_Socket, WorldPacket(*packet));
+                            sScriptMgr->OnPacketReceive(m_Socket, *packet);
                             (this->*opHandle.handler)(*packet);
                             LogUnprocessedTail(packet);
                         }
@@ -333,7 +446,7 @@ bool WorldSession::Update(uint32 diff, PacketFilter& updater)
                             LogUnexpectedOpcode(packet, "STATUS_TRANSFER", "the player is still in world");
                         else
                         {
-                            sScriptMgr->OnPacketReceive(m_Socket, WorldPacket(*packet));
+                            sScriptMgr->OnPacketReceive(m_Socket, *packet);
                             (this->*opHandle.handler)(*packet);
                             LogUnprocessedTail(packet);
                         }
@@ -351,7 +464,7 @@ bool WorldSession::Update(uint32 diff, PacketFilter& updater)
                         if (packet->GetOpcode() == CMSG_CHAR_ENUM)
                             m_playerRecentlyLogout = false;
 
-                        sScriptMgr->OnPacketReceive(m_Socket, WorldPacket(*packet));
+                        sScriptMgr->OnPacketReceive(m_Socket, *packet);
                         (this->*opHandle.handler)(*packet);
                         LogUnprocessedTail(packet);
                         break;
@@ -374,7 +487,10 @@ bool WorldSession::Update(uint32 diff, PacketFilter& updater)
         }
 
         if (deletePacket)
-            delete packet;
+        {
+            AccountOpcode(packet->GetOpcode());
+            RecyclePacket(packet);
+        }
     }
 
     if (m_Socket && !m_Socket->IsClosed() && _warden)
@@ -29,8 +29,12 @@
 #include "DatabaseEnv.h"
 #include "World.h"
 #include "WorldPacket.h"
+#include "WorldPacketRing.h"
 #include "Cryptography/BigNumber.h"
 
+#include <ace/Thread_Mutex.h>
+#include <deque>
+
 class Creature;
 class GameObject;
 class InstanceSave;
@@ -40,6 +44,7 @@ class Object;
 class Player;
 class Quest;
 class RBACData;
+class SharedPacketPayload;
 class SpellCastTargets;
 class Unit;
 class Warden;
@@ -122,6 +127,14 @@ enum CharterTypes
 
 //class to deal with packet processing
 //allows to determine if next packet is safe to be processed
+// received packets waiting for a session update in the lock-free ring, further ones wait in the
+// overflow list and only a client exceeding SessionRecvQueueLimit there is disconnected
+#define SESSION_RECV_QUEUE_SIZE         256
+// processed packets kept for reuse by the network thread
+#define SESSION_PACKET_POOL_SIZE        32
+// bigger packets are freed instead of keeping their buffer in the pool
+#define SESSION_PACKET_POOL_MAX_SIZE    1024
+
 class PacketFilter
 {
 public:
@@ -206,6 +219,7 @@ class WorldSession
         void WriteMovementInfo(WorldPacket* data, MovementInfo* mi);
 
         void SendPacket(WorldPacket const* packet);
+        void SendPacket(SharedPacketPayload const& payload);
         void SendNotification(const char *format, ...) ATTR_PRINTF(2, 3);
         void SendNotification(uint32 string_id, ...);
         void SendPetNameInvalid(uint32 error, std::string const& name, DeclinedName *declinedName);
@@ -257,7 +271,12 @@ class WorldSession
         void LogoutPlayer(bool save);
         void KickPlayer();
 
-        void QueuePacket(WorldPacket* new_packet);
+        bool QueuePacket(WorldPacket* new_packet);
+        // consumer side of the receive queue, the ring first and then the overflow list
+        WorldPacket* PeekRecvPacket();
+        void PopRecvPacket();
+        // called by the network thread for every received packet
+        WorldPacket* AllocateRecvPacket(uint16 opcode, size_t size);
         bool Update(uint32 diff, PacketFilter& updater);
 
         /// Handle the authentication waiting queue (to be completed)
@@ -919,6 +938,9 @@ class WorldSession
         void LogUnexpectedOpcode(WorldPacket* packet, const char* status, const char *reason);
         void LogUnprocessedTail(WorldPacket* packet);
 
+        void RecyclePacket(WorldPacket* packet);
+        void AccountOpcode(uint16 opcode);
+
         // EnumData helpers
         bool IsLegitCharacterForAccount(uint32 lowGUID)
         {
@@ -958,7 +980,18 @@ class WorldSession
         AddonsList m_addonsList;
         uint32 recruiterId;
         bool isRecruiter;
-        ACE_Based::LockedQueue<WorldPacket*, ACE_Thread_Mutex> _recvQueue;
+        WorldPacketRing<WorldPacket, SESSION_RECV_QUEUE_SIZE> _recvQueue;
+        // packets received while the ring was full, newer than anything in the ring
+        std::deque<WorldPacket*> _recvOverflow;
+        long volatile _recvOverflowSize;                    // written under the lock, read without it to skip it when empty
+        bool _recvPeekedOverflow;                           // the packet returned by PeekRecvPacket() is the overflow front
+        ACE_Thread_Mutex _recvOverflowLock;
+        WorldPacketRing<WorldPacket, SESSION_PACKET_POOL_SIZE> _freePackets;
+
+        // handled packets per opcode in the current one second window
+        typedef UNORDERED_MAP<uint16, uint32> OpcodeRateMap;
+        OpcodeRateMap _opcodeRates;
+        uint32 _opcodeRateWindowStart;
         time_t timeLastWhoCommand;
         RBACData* _RBACData;
 };
@@ -26,6 +26,10 @@
 #include <ace/OS_NS_string.h>
 #include <ace/Reactor.h>
 #include <ace/Auto_Ptr.h>
+#include <ace/Lock_Adapter_T.h>
+#include <ace/Message_Queue.h>
+#include <ace/OS_NS_sys_socket.h>
+#include <ace/os_include/sys/os_uio.h>
 
 #include "WorldSocket.h"
 #include "Common.h"
@@ -46,6 +50,9 @@
 #include "ScriptMgr.h"
 #include "AccountMgr.h"
 
+// iovec entries gathered by one write, output beyond that waits for the next one
+#define WORLD_SOCKET_MAX_IOV 64
+
 #if defined(__GNUC__)
 #pragma pack(1)
 #else
@@ -152,7 +159,38 @@ const std::string& WorldSocket::GetRemoteAddress (void) const
     return m_Address;
 }
 
+// reference counts of shared payloads are updated by every thread sending them
+static ACE_Lock_Adapter<ACE_Thread_Mutex> SharedPacketPayloadLock;
+
+SharedPacketPayload::SharedPacketPayload(WorldPacket const& packet) : m_Packet(packet), m_Payload(NULL)
+{
+    m_Payload = new ACE_Message_Block(packet.size(), ACE_Message_Block::MB_DATA, 0, 0, 0, &SharedPacketPayloadLock);
+
+    if (!packet.empty())
+        m_Payload->copy((char const*)packet.contents(), packet.size());
+}
+
+SharedPacketPayload::~SharedPacketPayload()
+{
+    m_Payload->release();
+}
+
+ACE_Message_Block* SharedPacketPayload::Duplicate() const
+{
+    return m_Payload->duplicate();
+}
+
 int WorldSocket::SendPacket(WorldPacket const& pct)
+{
+    return SendPacket(pct, NULL);
+}
+
+int WorldSocket::SendPacket(SharedPacketPayload const& payload)
+{
+    return SendPacket(payload.GetPacket(), &payload);
+}
+
+int WorldSocket::SendPacket(WorldPacket const& pct, SharedPacketPayload const* shared)
 {
     ACE_GUARD_RETURN (LockType, Guard, m_OutBufferLock, -1);
 
@@ -174,7 +212,7 @@ int WorldSocket::SendPacket(WorldPacket const& pct)
     ServerPktHeader header(pkt->size()+2, pkt->GetOpcode());
     m_Crypt.EncryptSend ((uint8*)header.header, header.getHeaderLength());
 
-    if (m_OutBuffer->space() >= pkt->size() + header.getHeaderLength() && msg_queue()->is_empty())
+    if (!shared && m_OutBuffer->space() >= pkt->size() + header.getHeaderLength() && msg_queue()->is_empty())
     {
         // Put the packet on the buffer.
         if (m_OutBuffer->copy((char*) header.header, header.getHeaderLength()) == -1)
@@ -183,25 +221,38 @@ int WorldSocket::SendPacket(WorldPacket const& pct)
         if (!pkt->empty())
             if (m_OutBuffer->copy((char*) pkt->contents(), pkt->size()) == -1)
                 ACE_ASSERT (false);
+
+        return 0;
     }
-    else
+
+    // Enqueue the packet.
+    ACE_Message_Block* mb;
+
+    if (shared)
     {
-        // Enqueue the packet.
-        ACE_Message_Block* mb;
+        // only the encrypted header belongs to this socket, the payload is referenced
+        ACE_NEW_RETURN(mb, ACE_Message_Block(header.getHeaderLength()), -1);
 
+        mb->copy((char*) header.header, header.getHeaderLength());
+
+        if (!pkt->empty())
+            mb->cont(shared->Duplicate());
+    }
+    else
+    {
         ACE_NEW_RETURN(mb, ACE_Message_Block(pkt->size() + header.getHeaderLength()), -1);
 
         mb->copy((char*) header.header, header.getHeaderLength());
 
         if (!pkt->empty())
             mb->copy((const char*)pkt->contents(), pkt->size());
+    }
 
-        if (msg_queue()->enqueue_tail(mb, (ACE_Time_Value*)&ACE_Time_Value::zero) == -1)
-        {
-            TC_LOG_ERROR(LOG_FILTER_NETWORKIO, "WorldSocket::SendPacket enqueue_tail failed");
-            mb->release();
-            return -1;
-        }
+    if (msg_queue()->enqueue_tail(mb, (ACE_Time_Value*)&ACE_Time_Value::zero) == -1)
+    {
+        TC_LOG_ERROR(LOG_FILTER_NETWORKIO, "WorldSocket::SendPacket enqueue_tail failed");
+        mb->release();
+        return -1;
     }
 
     return 0;
@@ -317,15 +368,52 @@ int WorldSocket::handle_output (ACE_HANDLE)
     if (closing_)
         return -1;
 
-    size_t send_len = m_OutBuffer->length();
+    return handle_output_gather(Guard);
+}
 
-    if (send_len == 0)
-        return handle_output_queue(Guard);
+int WorldSocket::handle_output_gather (GuardType& g)
+{
+    iovec iov[WORLD_SOCKET_MAX_IOV];
+    int iovcnt = 0;
+    size_t send_len = 0;
+
+    // the buffer always holds data older than anything queued
+    if (m_OutBuffer->length() > 0)
+    {
+        iov[iovcnt].iov_base = m_OutBuffer->rd_ptr();
+        iov[iovcnt].iov_len = m_OutBuffer->length();
+        send_len += m_OutBuffer->length();
+        ++iovcnt;
+    }
+
+    ACE_Message_Queue_Iterator<ACE_NULL_SYNCH> itr(*msg_queue());
+    for (ACE_Message_Block* mblk; iovcnt < WORLD_SOCKET_MAX_IOV && itr.next(mblk); itr.advance())
+    {
+        // header block first, then the referenced payload if any
+        for (; mblk && iovcnt < WORLD_SOCKET_MAX_IOV; mblk = mblk->cont())
+        {
+            if (mblk->length() == 0)
+                continue;
+
+            iov[iovcnt].iov_base = mblk->rd_ptr();
+            iov[iovcnt].iov_len = mblk->length();
+            send_len += mblk->length();
+            ++iovcnt;
+        }
+    }
+
+    if (iovcnt == 0)
+        return cancel_wakeup_output(g);
 
 #ifdef MSG_NOSIGNAL
-    ssize_t n = peer().send (m_OutBuffer->rd_ptr(), send_len, MSG_NOSIGNAL);
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    ssize_t n = ACE_OS::sendmsg(get_handle(), &msg, MSG_NOSIGNAL);
 #else
-    ssize_t n = peer().send (m_OutBuffer->rd_ptr(), send_len);
+    ssize_t n = peer().sendv(iov, iovcnt);
 #endif // MSG_NOSIGNAL
 
     if (n == 0)
@@ -333,88 +421,65 @@ int WorldSocket::handle_output (ACE_HANDLE)
     else if (n == -1)
     {
         if (errno == EWOULDBLOCK || errno == EAGAIN)
-            return schedule_wakeup_output (Guard);
+            return schedule_wakeup_output (g);
 
         return -1;
     }
-    else if (n < (ssize_t)send_len) //now n > 0
-    {
-        m_OutBuffer->rd_ptr (static_cast<size_t> (n));
 
-        // move the data to the base of the buffer
-        m_OutBuffer->crunch();
-
-        return schedule_wakeup_output (Guard);
-    }
-    else //now n == send_len
-    {
-        m_OutBuffer->reset();
+    if (consume_output(static_cast<size_t> (n)) == -1)
+        return -1;
 
-        return handle_output_queue (Guard);
-    }
+    if (n < (ssize_t)send_len)
+        return schedule_wakeup_output (g);
 
-    ACE_NOTREACHED (return 0);
+    // everything gathered is sent, the queue may hold more than fits in one write
+    return (m_OutBuffer->length() == 0 && msg_queue()->is_empty()) ? cancel_wakeup_output(g) : ACE_Event_Handler::WRITE_MASK;
 }
 
-int WorldSocket::handle_output_queue (GuardType& g)
+int WorldSocket::consume_output (size_t n)
 {
-    if (msg_queue()->is_empty())
-        return cancel_wakeup_output(g);
-
-    ACE_Message_Block* mblk;
-
-    if (msg_queue()->dequeue_head(mblk, (ACE_Time_Value*)&ACE_Time_Value::zero) == -1)
+    if (size_t buffered = std::min(n, m_OutBuffer->length()))
     {
-        TC_LOG_ERROR(LOG_FILTER_NETWORKIO, "WorldSocket::handle_output_queue dequeue_head");
-        return -1;
-    }
-
-    const size_t send_len = mblk->length();
+        m_OutBuffer->rd_ptr(buffered);
+        n -= buffered;
 
-#ifdef MSG_NOSIGNAL
-    ssize_t n = peer().send(mblk->rd_ptr(), send_len, MSG_NOSIGNAL);
-#else
-    ssize_t n = peer().send(mblk->rd_ptr(), send_len);
-#endif // MSG_NOSIGNAL
+        if (m_OutBuffer->length() == 0)
+            m_OutBuffer->reset();
+        else
+            m_OutBuffer->crunch();                          // move the data to the base of the buffer
+    }
 
-    if (n == 0)
+    while (n > 0)
     {
-        mblk->release();
+        ACE_Message_Block* mblk;
 
-        return -1;
-    }
-    else if (n == -1)
-    {
-        if (errno == EWOULDBLOCK || errno == EAGAIN)
+        if (msg_queue()->peek_dequeue_head(mblk, (ACE_Time_Value*)&ACE_Time_Value::zero) == -1)
         {
-            msg_queue()->enqueue_head(mblk, (ACE_Time_Value*) &ACE_Time_Value::zero);
-            return schedule_wakeup_output (g);
+            TC_LOG_ERROR(LOG_FILTER_NETWORKIO, "WorldSocket::consume_output peek_dequeue_head");
+            return -1;
         }
 
-        mblk->release();
-        return -1;
-    }
-    else if (n < (ssize_t)send_len) //now n > 0
-    {
-        mblk->rd_ptr(static_cast<size_t> (n));
+        for (ACE_Message_Block* part = mblk; part && n > 0; part = part->cont())
+        {
+            size_t step = std::min(n, part->length());
+            part->rd_ptr(step);
+            n -= step;
+        }
+
+        // partially sent, the rest goes with the next write
+        if (mblk->total_length() > 0)
+            break;
 
-        if (msg_queue()->enqueue_head(mblk, (ACE_Time_Value*) &ACE_Time_Value::zero) == -1)
+        if (msg_queue()->dequeue_head(mblk, (ACE_Time_Value*)&ACE_Time_Value::zero) == -1)
         {
-            TC_LOG_ERROR(LOG_FILTER_NETWORKIO, "WorldSocket::handle_output_queue enqueue_head");
-            mblk->release();
+            TC_LOG_ERROR(LOG_FILTER_NETWORKIO, "WorldSocket::consume_output dequeue_head");
             return -1;
         }
 
-        return schedule_wakeup_output (g);
-    }
-    else //now n == send_len
-    {
         mblk->release();
-
-        return msg_queue()->is_empty() ? cancel_wakeup_output(g) : ACE_Event_Handler::WRITE_MASK;
     }
 
-    ACE_NOTREACHED(return -1);
+    return 0;
 }
 
 int WorldSocket::handle_close (ACE_HANDLE h, ACE_Reactor_Mask)
@@ -484,7 +549,16 @@ int WorldSocket::handle_input_header (void)
 
     header.size -= 4;
 
-    ACE_NEW_RETURN(m_RecvWPct, WorldPacket ((uint16)header.cmd, header.size), -1);
+    {
+        // reuse the buffer of a packet the session already processed
+        ACE_GUARD_RETURN (LockType, Guard, m_SessionLock, -1);
+
+        if (m_Session)
+            m_RecvWPct = m_Session->AllocateRecvPacket((uint16)header.cmd, header.size);
+    }
+
+    if (!m_RecvWPct)
+        ACE_NEW_RETURN(m_RecvWPct, WorldPacket ((uint16)header.cmd, header.size), -1);
 
     if (header.size > 0)
     {
@@ -683,11 +757,11 @@ int WorldSocket::ProcessIncoming(WorldPacket* new_pct)
                     return -1;
                 }
 
-                sScriptMgr->OnPacketReceive(this, WorldPacket(*new_pct));
+                sScriptMgr->OnPacketReceive(this, *new_pct);
                 return HandleAuthSession(*new_pct);
             case CMSG_KEEP_ALIVE:
                 TC_LOG_DEBUG(LOG_FILTER_NETWORKIO, "%s", opcodeName.c_str());
-                sScriptMgr->OnPacketReceive(this, WorldPacket(*new_pct));
+                sScriptMgr->OnPacketReceive(this, *new_pct);
                 return 0;
             default:
             {
@@ -706,7 +780,13 @@ int WorldSocket::ProcessIncoming(WorldPacket* new_pct)
                 aptr.release();
                 // WARNING here we call it with locks held.
                 // Its possible to cause deadlock if QueuePacket calls back
-                m_Session->QueuePacket(new_pct);
+                if (!m_Session->QueuePacket(new_pct))
+                {
+                    TC_LOG_ERROR(LOG_FILTER_NETWORKIO, "WorldSocket::ProcessIncoming: %s exceeded SessionRecvQueueLimit queued packets, disconnecting", m_Session->GetPlayerInfo().c_str());
+                    delete new_pct;
+                    return -1;
+                }
+
                 return 0;
             }
         }
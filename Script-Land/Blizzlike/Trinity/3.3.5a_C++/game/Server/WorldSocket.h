@@ -45,6 +45,36 @@ class ACE_Message_Block;
 class WorldPacket;
 class WorldSession;
 
+/// Packets at least this big are worth sharing between the recipients of a broadcast
+#define SHARED_PACKET_MIN_SIZE 512
+
+/**
+ * Payload of a packet delivered to several sockets.
+ *
+ * The packet contents are copied once into a reference counted block, every
+ * socket then queues a reference to that block behind its own encrypted header
+ * instead of a private copy. The source packet must outlive the broadcast, it
+ * is still used for logging and script hooks.
+ */
+class SharedPacketPayload
+{
+    public:
+        explicit SharedPacketPayload(WorldPacket const& packet);
+        ~SharedPacketPayload();
+
+        WorldPacket const& GetPacket() const { return m_Packet; }
+
+        /// New reference to the payload, released by the socket once sent.
+        ACE_Message_Block* Duplicate() const;
+
+    private:
+        SharedPacketPayload(SharedPacketPayload const&);
+        SharedPacketPayload& operator=(SharedPacketPayload const&);
+
+        WorldPacket const& m_Packet;
+        ACE_Message_Block* m_Payload;
+};
+
 /// Handler that can communicate over stream sockets.
 typedef ACE_Svc_Handler<ACE_SOCK_STREAM, ACE_NULL_SYNCH> WorldHandler;
 
@@ -69,6 +99,11 @@ typedef ACE_Svc_Handler<ACE_SOCK_STREAM, ACE_NULL_SYNCH> WorldHandler;
  * sending packets from "producer" threads is minimal,
  * and doing a lot of writes with small size is tolerated.
  *
+ * Big broadcast payloads are not copied, the queue holds a
+ * reference to them chained behind the socket's own header.
+ * The buffer and the queue are flushed together with one
+ * gather write.
+ *
  * The calls to Update() method are managed by WorldSocketMgr
  * and ReactorRunnable.
  *
@@ -110,6 +145,9 @@ class WorldSocket : public WorldHandler
         /// @return -1 of failure
         int SendPacket(const WorldPacket& pct);
 
+        /// Send a broadcast packet, queues a reference to the payload instead of a copy.
+        int SendPacket(SharedPacketPayload const& payload);
+
         /// Add reference to this object.
         long AddReference(void);
 
@@ -148,8 +186,14 @@ class WorldSocket : public WorldHandler
         int cancel_wakeup_output(GuardType& g);
         int schedule_wakeup_output(GuardType& g);
 
-        /// Drain the queue if its not empty.
-        int handle_output_queue(GuardType& g);
+        /// Send the output buffer and queued packets with one gather write.
+        int handle_output_gather(GuardType& g);
+
+        /// Drop the first @a n bytes of pending output after a successful write.
+        int consume_output(size_t n);
+
+        /// Common part of the SendPacket overloads, @a shared may be NULL.
+        int SendPacket(WorldPacket const& pct, SharedPacketPayload const* shared);
 
         /// process one incoming packet.
         /// @param new_pct received packet, note that you need to delete it.
@@ -45,6 +45,7 @@ class AuraApplication
     friend void Unit::_ApplyAuraEffect(Aura* aura, uint8 effIndex);
     friend void Unit::RemoveAura(AuraApplication * aurApp, AuraRemoveMode mode);
     friend AuraApplication * Unit::_CreateAuraApplication(Aura* aura, uint8 effMask);
+    friend void Unit::_RegisterProcAura(AuraApplication * aurApp);
     private:
         Unit* const _target;
         Aura* const _base;
@@ -53,6 +54,7 @@ class AuraApplication
         uint8 _flags;                                  // Aura info flag
         uint8 _effectsToApply;                         // Used only at spell hit to determine which effect should be applied
         bool _needClientUpdate:1;
+        uint32 _procFlags;                             // spell_proc_event flags the target's proc index holds it with
 
         explicit AuraApplication(Unit* target, Unit* caster, Aura* base, uint8 effMask);
         void _Remove();
@@ -71,6 +73,7 @@ class AuraApplication
         bool IsPositive() const { return _flags & AFLAG_POSITIVE; }
         bool IsSelfcasted() const { return _flags & AFLAG_CASTER; }
         uint8 GetEffectsToApply() const { return _effectsToApply; }
+        uint32 GetProcFlags() const { return _procFlags; }
 
         void SetRemoveMode(AuraRemoveMode mode) { _removeMode = mode; }
         AuraRemoveMode GetRemoveMode() const {return _removeMode;}
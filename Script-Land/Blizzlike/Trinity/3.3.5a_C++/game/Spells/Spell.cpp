@@ -55,6 +55,7 @@
 #include "SpellInfo.h"
 #include "Battlefield.h"
 #include "BattlefieldMgr.h"
+#include "SpellTargetBuffer.h"
 
 extern pEffect SpellEffects[TOTAL_SPELL_EFFECTS];
 
@@ -1041,6 +1042,46 @@ void Spell::SelectImplicitNearbyTargets(SpellEffIndex effIndex, SpellImplicitTar
     SelectImplicitChainTargets(effIndex, targetType, target, effMask);
 }
 
+// order preserving random subset of at most maxTargets entries, the vector counterpart of Trinity::Containers::RandomResizeList
+template<class T>
+static void RandomResizeTargets(std::vector<T*>& targets, uint32 maxTargets)
+{
+    if (targets.size() <= maxTargets)
+        return;
+
+    uint32 kept = 0;
+    uint32 remaining = uint32(targets.size());
+    for (uint32 i = 0; i < targets.size() && kept < maxTargets; ++i, --remaining)
+        if (urand(1, remaining) <= maxTargets - kept)
+            targets[kept++] = targets[i];
+
+    targets.resize(kept);
+}
+
+struct SpellTargetNotInRaidWith
+{
+    explicit SpellTargetNotInRaidWith(Unit const* caster) : _caster(caster) { }
+    bool operator()(Unit const* target) const { return !target->IsInRaidWith(_caster); }
+
+    Unit const* _caster;
+};
+
+struct SpellTargetPowerTypeDiffers
+{
+    explicit SpellTargetPowerTypeDiffers(Powers power) : _power(power) { }
+    bool operator()(Unit const* target) const { return target->getPowerType() != _power; }
+
+    Powers _power;
+};
+
+struct SpellTargetNotInFrontOf
+{
+    explicit SpellTargetNotInFrontOf(Unit const* caster) : _caster(caster) { }
+    bool operator()(WorldObject const* target) const { return !_caster->HasInArc(static_cast<float>(M_PI), target); }
+
+    Unit const* _caster;
+};
+
 void Spell::SelectImplicitConeTargets(SpellEffIndex effIndex, SpellImplicitTargetInfo const& targetType, uint32 effMask)
 {
     if (targetType.GetReferenceType() != TARGET_REFERENCE_TYPE_CASTER)
@@ -1048,7 +1089,7 @@ void Spell::SelectImplicitConeTargets(SpellEffIndex effIndex, SpellImplicitTarge
         ASSERT(false && "Spell::SelectImplicitConeTargets: received not implemented target reference type");
         return;
     }
-    std::list<WorldObject*> targets;
+    SpellTargetBuffer<WorldObject> targets;
     SpellTargetObjectTypes objectType = targetType.GetObjectType();
     SpellTargetCheckTypes selectionType = targetType.GetCheckType();
     ConditionList* condList = m_spellInfo->Effects[effIndex].ImplicitTargetConditions;
@@ -1057,13 +1098,14 @@ void Spell::SelectImplicitConeTargets(SpellEffIndex effIndex, SpellImplicitTarge
 
     if (uint32 containerTypeMask = GetSearcherTypeMask(objectType, condList))
     {
+        typedef Trinity::WorldObjectListSearcher<Trinity::WorldObjectSpellConeTargetCheck, std::vector<WorldObject*> > ConeSearcher;
         Trinity::WorldObjectSpellConeTargetCheck check(coneAngle, radius, m_caster, m_spellInfo, selectionType, condList);
-        Trinity::WorldObjectListSearcher<Trinity::WorldObjectSpellConeTargetCheck> searcher(m_caster, targets, check, containerTypeMask);
-        SearchTargets<Trinity::WorldObjectListSearcher<Trinity::WorldObjectSpellConeTargetCheck> >(searcher, containerTypeMask, m_caster, m_caster, radius);
+        ConeSearcher searcher(m_caster, *targets, check, containerTypeMask);
+        SearchTargets<ConeSearcher>(searcher, containerTypeMask, m_caster, m_caster, radius);
 
-        CallScriptObjectAreaTargetSelectHandlers(targets, effIndex);
+        CallScriptObjectAreaTargetSelectHandlers(*targets, effIndex);
 
-        if (!targets.empty())
+        if (!targets->empty())
         {
             // Other special target selection goes here
             if (uint32 maxTargets = m_spellValue->MaxAffectedTargets)
@@ -1073,26 +1115,26 @@ void Spell::SelectImplicitConeTargets(SpellEffIndex effIndex, SpellImplicitTarge
                     if ((*j)->IsAffectedOnSpell(m_spellInfo))
                         maxTargets += (*j)->GetAmount();
 
-                Trinity::Containers::RandomResizeList(targets, maxTargets);
+                RandomResizeTargets(*targets, maxTargets);
             }
 
             // for compability with older code - add only unit and go targets
             /// @todo remove this
-            std::list<Unit*> unitTargets;
-            std::list<GameObject*> gObjTargets;
+            SpellTargetBuffer<Unit> unitTargets;
+            SpellTargetBuffer<GameObject> gObjTargets;
 
-            for (std::list<WorldObject*>::iterator itr = targets.begin(); itr != targets.end(); ++itr)
+            for (std::vector<WorldObject*>::const_iterator itr = targets->begin(); itr != targets->end(); ++itr)
             {
                 if (Unit* unitTarget = (*itr)->ToUnit())
-                    unitTargets.push_back(unitTarget);
+                    unitTargets->push_back(unitTarget);
                 else if (GameObject* gObjTarget = (*itr)->ToGameObject())
-                    gObjTargets.push_back(gObjTarget);
+                    gObjTargets->push_back(gObjTarget);
             }
 
-            for (std::list<Unit*>::iterator itr = unitTargets.begin(); itr != unitTargets.end(); ++itr)
+            for (std::vector<Unit*>::const_iterator itr = unitTargets->begin(); itr != unitTargets->end(); ++itr)
                 AddUnitTarget(*itr, effMask, false);
 
-            for (std::list<GameObject*>::iterator itr = gObjTargets.begin(); itr != gObjTargets.end(); ++itr)
+            for (std::vector<GameObject*>::const_iterator itr = gObjTargets->begin(); itr != gObjTargets->end(); ++itr)
                 AddGOTarget(*itr, effMask);
         }
     }
@@ -1149,9 +1191,9 @@ void Spell::SelectImplicitAreaTargets(SpellEffIndex effIndex, SpellImplicitTarge
              ASSERT(false && "Spell::SelectImplicitAreaTargets: received not implemented target reference type");
              return;
     }
-    std::list<WorldObject*> targets;
+    SpellTargetBuffer<WorldObject> targets;
     float radius = m_spellInfo->Effects[effIndex].CalcRadius(m_caster) * m_spellValue->RadiusMod;
-    SearchAreaTargets(targets, radius, center, referer, targetType.GetObjectType(), targetType.GetCheckType(), m_spellInfo->Effects[effIndex].ImplicitTargetConditions);
+    SearchAreaTargets(*targets, radius, center, referer, targetType.GetObjectType(), targetType.GetCheckType(), m_spellInfo->Effects[effIndex].ImplicitTargetConditions);
 
     // Custom entries
     /// @todo remove those
@@ -1161,7 +1203,7 @@ void Spell::SelectImplicitAreaTargets(SpellEffIndex effIndex, SpellImplicitTarge
         {
             if (Player* playerCaster = m_caster->ToPlayer())
             {
-                for (std::list<WorldObject*>::iterator itr = targets.begin(); itr != targets.end(); ++itr)
+                for (std::vector<WorldObject*>::const_iterator itr = targets->begin(); itr != targets->end(); ++itr)
                 {
                     switch ((*itr)->GetTypeId())
                     {
@@ -1200,7 +1242,7 @@ void Spell::SelectImplicitAreaTargets(SpellEffIndex effIndex, SpellImplicitTarge
                 // remove existing targets
                 CleanupTargetList();
 
-                for (std::list<WorldObject*>::iterator itr = targets.begin(); itr != targets.end(); ++itr)
+                for (std::vector<WorldObject*>::const_iterator itr = targets->begin(); itr != targets->end(); ++itr)
                 {
                     switch ((*itr)->GetTypeId())
                     {
@@ -1224,13 +1266,15 @@ void Spell::SelectImplicitAreaTargets(SpellEffIndex effIndex, SpellImplicitTarge
             break;
     }
 
-    CallScriptObjectAreaTargetSelectHandlers(targets, effIndex);
+    CallScriptObjectAreaTargetSelectHandlers(*targets, effIndex);
 
-    std::list<Unit*> unitTargets;
-    std::list<GameObject*> gObjTargets;
+    SpellTargetBuffer<Unit> unitTargetBuffer;
+    SpellTargetBuffer<GameObject> gObjTargetBuffer;
+    std::vector<Unit*>& unitTargets = *unitTargetBuffer;
+    std::vector<GameObject*>& gObjTargets = *gObjTargetBuffer;
     // for compability with older code - add only unit and go targets
     /// @todo remove this
-    for (std::list<WorldObject*>::iterator itr = targets.begin(); itr != targets.end(); ++itr)
+    for (std::vector<WorldObject*>::const_iterator itr = targets->begin(); itr != targets->end(); ++itr)
     {
         if (Unit* unitTarget = (*itr)->ToUnit())
             unitTargets.push_back(unitTarget);
@@ -1293,13 +1337,7 @@ void Spell::SelectImplicitAreaTargets(SpellEffIndex effIndex, SpellImplicitTarge
                     break;
 
                 // Remove targets outside caster's raid
-                for (std::list<Unit*>::iterator itr = unitTargets.begin(); itr != unitTargets.end();)
-                {
-                    if (!(*itr)->IsInRaidWith(m_caster))
-                        itr = unitTargets.erase(itr);
-                    else
-                        ++itr;
-                }
+                unitTargets.erase(std::remove_if(unitTargets.begin(), unitTargets.end(), SpellTargetNotInRaidWith(m_caster)), unitTargets.end());
                 break;
             case SPELLFAMILY_DRUID:
                 if (m_spellInfo->SpellFamilyFlags[1] == 0x04000000) // Wild Growth
@@ -1311,11 +1349,7 @@ void Spell::SelectImplicitAreaTargets(SpellEffIndex effIndex, SpellImplicitTarge
                     break;
 
                 // Remove targets outside caster's raid
-                for (std::list<Unit*>::iterator itr = unitTargets.begin(); itr != unitTargets.end();)
-                    if (!(*itr)->IsInRaidWith(m_caster))
-                        itr = unitTargets.erase(itr);
-                    else
-                        ++itr;
+                unitTargets.erase(std::remove_if(unitTargets.begin(), unitTargets.end(), SpellTargetNotInRaidWith(m_caster)), unitTargets.end());
                 break;
             default:
                 break;
@@ -1327,21 +1361,17 @@ void Spell::SelectImplicitAreaTargets(SpellEffIndex effIndex, SpellImplicitTarge
             {
                 if (unitTargets.size() > maxSize)
                 {
-                    unitTargets.sort(Trinity::HealthPctOrderPred());
+                    std::stable_sort(unitTargets.begin(), unitTargets.end(), Trinity::HealthPctOrderPred());
                     unitTargets.resize(maxSize);
                 }
             }
             else
             {
-                for (std::list<Unit*>::iterator itr = unitTargets.begin(); itr != unitTargets.end();)
-                    if ((*itr)->getPowerType() != (Powers)power)
-                        itr = unitTargets.erase(itr);
-                    else
-                        ++itr;
+                unitTargets.erase(std::remove_if(unitTargets.begin(), unitTargets.end(), SpellTargetPowerTypeDiffers((Powers)power)), unitTargets.end());
 
                 if (unitTargets.size() > maxSize)
                 {
-                    unitTargets.sort(Trinity::PowerPctOrderPred((Powers)power));
+                    std::stable_sort(unitTargets.begin(), unitTargets.end(), Trinity::PowerPctOrderPred((Powers)power));
                     unitTargets.resize(maxSize);
                 }
             }
@@ -1355,10 +1385,10 @@ void Spell::SelectImplicitAreaTargets(SpellEffIndex effIndex, SpellImplicitTarge
                 if ((*j)->IsAffectedOnSpell(m_spellInfo))
                     maxTargets += (*j)->GetAmount();
 
-            Trinity::Containers::RandomResizeList(unitTargets, maxTargets);
+            RandomResizeTargets(unitTargets, maxTargets);
         }
 
-        for (std::list<Unit*>::iterator itr = unitTargets.begin(); itr != unitTargets.end(); ++itr)
+        for (std::vector<Unit*>::const_iterator itr = unitTargets.begin(); itr != unitTargets.end(); ++itr)
             AddUnitTarget(*itr, effMask, false);
     }
 
@@ -1371,10 +1401,10 @@ void Spell::SelectImplicitAreaTargets(SpellEffIndex effIndex, SpellImplicitTarge
                 if ((*j)->IsAffectedOnSpell(m_spellInfo))
                     maxTargets += (*j)->GetAmount();
 
-            Trinity::Containers::RandomResizeList(gObjTargets, maxTargets);
+            RandomResizeTargets(gObjTargets, maxTargets);
         }
 
-        for (std::list<GameObject*>::iterator itr = gObjTargets.begin(); itr != gObjTargets.end(); ++itr)
+        for (std::vector<GameObject*>::const_iterator itr = gObjTargets.begin(); itr != gObjTargets.end(); ++itr)
             AddGOTarget(*itr, effMask);
     }
 }
@@ -1603,20 +1633,20 @@ void Spell::SelectImplicitChainTargets(SpellEffIndex effIndex, SpellImplicitTarg
                 m_damageMultipliers[k] = 1.0f;
         m_applyMultiplierMask |= effMask;
 
-        std::list<WorldObject*> targets;
-        SearchChainTargets(targets, maxTargets - 1, target, targetType.GetObjectType(), targetType.GetCheckType()
+        SpellTargetBuffer<WorldObject> targets;
+        SearchChainTargets(*targets, maxTargets - 1, target, targetType.GetObjectType(), targetType.GetCheckType()
             , m_spellInfo->Effects[effIndex].ImplicitTargetConditions, targetType.GetTarget() == TARGET_UNIT_TARGET_CHAINHEAL_ALLY);
 
         // Chain primary target is added earlier
-        CallScriptObjectAreaTargetSelectHandlers(targets, effIndex);
+        CallScriptObjectAreaTargetSelectHandlers(*targets, effIndex);
 
         // for backward compability
-        std::list<Unit*> unitTargets;
-        for (std::list<WorldObject*>::iterator itr = targets.begin(); itr != targets.end(); ++itr)
+        SpellTargetBuffer<Unit> unitTargets;
+        for (std::vector<WorldObject*>::const_iterator itr = targets->begin(); itr != targets->end(); ++itr)
             if (Unit* unitTarget = (*itr)->ToUnit())
-                unitTargets.push_back(unitTarget);
+                unitTargets->push_back(unitTarget);
 
-        for (std::list<Unit*>::iterator itr = unitTargets.begin(); itr != unitTargets.end(); ++itr)
+        for (std::vector<Unit*>::const_iterator itr = unitTargets->begin(); itr != unitTargets->end(); ++itr)
             AddUnitTarget(*itr, effMask, false);
     }
 }
@@ -1646,14 +1676,16 @@ void Spell::SelectImplicitTrajTargets()
 
     float srcToDestDelta = m_targets.GetDstPos()->m_positionZ - m_targets.GetSrcPos()->m_positionZ;
 
-    std::list<WorldObject*> targets;
+    SpellTargetBuffer<WorldObject> targetBuffer;
+    std::vector<WorldObject*>& targets = *targetBuffer;
+    typedef Trinity::WorldObjectListSearcher<Trinity::WorldObjectSpellTrajTargetCheck, std::vector<WorldObject*> > TrajSearcher;
     Trinity::WorldObjectSpellTrajTargetCheck check(dist2d, m_targets.GetSrcPos(), m_caster, m_spellInfo);
-    Trinity::WorldObjectListSearcher<Trinity::WorldObjectSpellTrajTargetCheck> searcher(m_caster, targets, check, GRID_MAP_TYPE_MASK_ALL);
-    SearchTargets<Trinity::WorldObjectListSearcher<Trinity::WorldObjectSpellTrajTargetCheck> > (searcher, GRID_MAP_TYPE_MASK_ALL, m_caster, m_targets.GetSrcPos(), dist2d);
+    TrajSearcher searcher(m_caster, targets, check, GRID_MAP_TYPE_MASK_ALL);
+    SearchTargets<TrajSearcher> (searcher, GRID_MAP_TYPE_MASK_ALL, m_caster, m_targets.GetSrcPos(), dist2d);
     if (targets.empty())
         return;
 
-    targets.sort(Trinity::ObjectDistanceOrderPred(m_caster));
+    std::stable_sort(targets.begin(), targets.end(), Trinity::ObjectDistanceOrderPred(m_caster));
 
     float b = tangent(m_targets.GetElevation());
     float a = (srcToDestDelta - dist2d * b) / (dist2d * dist2d);
@@ -1663,7 +1695,7 @@ void Spell::SelectImplicitTrajTargets()
 
     float bestDist = m_spellInfo->GetMaxRange(false);
 
-    std::list<WorldObject*>::const_iterator itr = targets.begin();
+    std::vector<WorldObject*>::const_iterator itr = targets.begin();
     for (; itr != targets.end(); ++itr)
     {
         if (Unit* unitTarget = (*itr)->ToUnit())
@@ -1931,17 +1963,18 @@ WorldObject* Spell::SearchNearbyTarget(float range, SpellTargetObjectTypes objec
     return target;
 }
 
-void Spell::SearchAreaTargets(std::list<WorldObject*>& targets, float range, Position const* position, Unit* referer, SpellTargetObjectTypes objectType, SpellTargetCheckTypes selectionType, ConditionList* condList)
+void Spell::SearchAreaTargets(std::vector<WorldObject*>& targets, float range, Position const* position, Unit* referer, SpellTargetObjectTypes objectType, SpellTargetCheckTypes selectionType, ConditionList* condList)
 {
     uint32 containerTypeMask = GetSearcherTypeMask(objectType, condList);
     if (!containerTypeMask)
         return;
+    typedef Trinity::WorldObjectListSearcher<Trinity::WorldObjectSpellAreaTargetCheck, std::vector<WorldObject*> > AreaSearcher;
     Trinity::WorldObjectSpellAreaTargetCheck check(range, position, m_caster, referer, m_spellInfo, selectionType, condList);
-    Trinity::WorldObjectListSearcher<Trinity::WorldObjectSpellAreaTargetCheck> searcher(m_caster, targets, check, containerTypeMask);
-    SearchTargets<Trinity::WorldObjectListSearcher<Trinity::WorldObjectSpellAreaTargetCheck> > (searcher, containerTypeMask, m_caster, position, range);
+    AreaSearcher searcher(m_caster, targets, check, containerTypeMask);
+    SearchTargets<AreaSearcher> (searcher, containerTypeMask, m_caster, position, range);
 }
 
-void Spell::SearchChainTargets(std::list<WorldObject*>& targets, uint32 chainTargets, WorldObject* target, SpellTargetObjectTypes objectType, SpellTargetCheckTypes selectType, ConditionList* condList, bool isChainHeal)
+void Spell::SearchChainTargets(std::vector<WorldObject*>& targets, uint32 chainTargets, WorldObject* target, SpellTargetObjectTypes objectType, SpellTargetCheckTypes selectType, ConditionList* condList, bool isChainHeal)
 {
     // max dist for jump target selection
     float jumpRadius = 0.0f;
@@ -1976,31 +2009,25 @@ void Spell::SearchChainTargets(std::list<WorldObject*>& targets, uint32 chainTar
     if (isBouncingFar)
         searchRadius *= chainTargets;
 
-    std::list<WorldObject*> tempTargets;
+    SpellTargetBuffer<WorldObject> tempTargetBuffer;
+    std::vector<WorldObject*>& tempTargets = *tempTargetBuffer;
     SearchAreaTargets(tempTargets, searchRadius, target, m_caster, objectType, selectType, condList);
-    tempTargets.remove(target);
+    tempTargets.erase(std::remove(tempTargets.begin(), tempTargets.end(), target), tempTargets.end());
 
     // remove targets which are always invalid for chain spells
     // for some spells allow only chain targets in front of caster (swipe for example)
     if (!isBouncingFar)
-    {
-        for (std::list<WorldObject*>::iterator itr = tempTargets.begin(); itr != tempTargets.end();)
-        {
-            std::list<WorldObject*>::iterator checkItr = itr++;
-            if (!m_caster->HasInArc(static_cast<float>(M_PI), *checkItr))
-                tempTargets.erase(checkItr);
-        }
-    }
+        tempTargets.erase(std::remove_if(tempTargets.begin(), tempTargets.end(), SpellTargetNotInFrontOf(m_caster)), tempTargets.end());
 
     while (chainTargets)
     {
         // try to get unit for next chain jump
-        std::list<WorldObject*>::iterator foundItr = tempTargets.end();
+        std::vector<WorldObject*>::iterator foundItr = tempTargets.end();
         // get unit with highest hp deficit in dist
         if (isChainHeal)
         {
             uint32 maxHPDeficit = 0;
-            for (std::list<WorldObject*>::iterator itr = tempTargets.begin(); itr != tempTargets.end(); ++itr)
+            for (std::vector<WorldObject*>::iterator itr = tempTargets.begin(); itr != tempTargets.end(); ++itr)
             {
                 if (Unit* unitTarget = (*itr)->ToUnit())
                 {
@@ -2016,7 +2043,7 @@ void Spell::SearchChainTargets(std::list<WorldObject*>& targets, uint32 chainTar
         // get closest object
         else
         {
-            for (std::list<WorldObject*>::iterator itr = tempTargets.begin(); itr != tempTargets.end(); ++itr)
+            for (std::vector<WorldObject*>::iterator itr = tempTargets.begin(); itr != tempTargets.end(); ++itr)
             {
                 if (foundItr == tempTargets.end())
                 {
@@ -7140,6 +7167,31 @@ void Spell::CallScriptObjectAreaTargetSelectHandlers(std::list<WorldObject*>& ta
     }
 }
 
+void Spell::CallScriptObjectAreaTargetSelectHandlers(std::vector<WorldObject*>& targets, SpellEffIndex effIndex)
+{
+    // scripts receive a std::list; only build one when a script hooks this effect
+    bool hooked = false;
+    for (std::list<SpellScript*>::const_iterator scritr = m_loadedScripts.begin(); scritr != m_loadedScripts.end() && !hooked; ++scritr)
+    {
+        std::list<SpellScript::ObjectAreaTargetSelectHandler>::iterator hookItrEnd = (*scritr)->OnObjectAreaTargetSelect.end(), hookItr = (*scritr)->OnObjectAreaTargetSelect.begin();
+        for (; hookItr != hookItrEnd; ++hookItr)
+        {
+            if ((*hookItr).IsEffectAffected(m_spellInfo, effIndex))
+            {
+                hooked = true;
+                break;
+            }
+        }
+    }
+
+    if (!hooked)
+        return;
+
+    std::list<WorldObject*> scriptTargets(targets.begin(), targets.end());
+    CallScriptObjectAreaTargetSelectHandlers(scriptTargets, effIndex);
+    targets.assign(scriptTargets.begin(), scriptTargets.end());
+}
+
 void Spell::CallScriptObjectTargetSelectHandlers(WorldObject*& target, SpellEffIndex effIndex)
 {
     for (std::list<SpellScript*>::iterator scritr = m_loadedScripts.begin(); scritr != m_loadedScripts.end(); ++scritr)
@@ -7410,9 +7462,14 @@ WorldObjectSpellAreaTargetCheck::WorldObjectSpellAreaTargetCheck(float range, Po
 {
 }
 
+bool WorldObjectSpellAreaTargetCheck::IsInRange(WorldObject* target) const
+{
+    return target->IsWithinDist3d(_position, _range) || (target->ToGameObject() && target->ToGameObject()->IsInRange(_position->GetPositionX(), _position->GetPositionY(), _position->GetPositionZ(), _range));
+}
+
 bool WorldObjectSpellAreaTargetCheck::operator()(WorldObject* target)
 {
-    if (!target->IsWithinDist3d(_position, _range) && !(target->ToGameObject() && target->ToGameObject()->IsInRange(_position->GetPositionX(), _position->GetPositionY(), _position->GetPositionZ(), _range)))
+    if (!IsInRange(target))
         return false;
     return WorldObjectSpellTargetCheck::operator ()(target);
 }
@@ -7425,6 +7482,10 @@ WorldObjectSpellConeTargetCheck::WorldObjectSpellConeTargetCheck(float coneAngle
 
 bool WorldObjectSpellConeTargetCheck::operator()(WorldObject* target)
 {
+    // the grid visit hands over whole cells, reject what is out of the radius before the angle math
+    if (!IsInRange(target))
+        return false;
+
     if (_spellInfo->AttributesCu & SPELL_ATTR0_CU_CONE_BACK)
     {
         if (!_caster->isInBack(target, _coneAngle))
@@ -7440,7 +7501,7 @@ bool WorldObjectSpellConeTargetCheck::operator()(WorldObject* target)
         if (!_caster->isInFront(target, _coneAngle))
             return false;
     }
-    return WorldObjectSpellAreaTargetCheck::operator ()(target);
+    return WorldObjectSpellTargetCheck::operator ()(target);
 }
 
 WorldObjectSpellTrajTargetCheck::WorldObjectSpellTrajTargetCheck(float range, Position const* position, Unit* caster, SpellInfo const* spellInfo)
@@ -7450,10 +7511,12 @@ WorldObjectSpellTrajTargetCheck::WorldObjectSpellTrajTargetCheck(float range, Po
 
 bool WorldObjectSpellTrajTargetCheck::operator()(WorldObject* target)
 {
+    if (!IsInRange(target))
+        return false;
     // return all targets on missile trajectory (0 - size of a missile)
     if (!_caster->HasInLine(target, 0))
         return false;
-    return WorldObjectSpellAreaTargetCheck::operator ()(target);
+    return WorldObjectSpellTargetCheck::operator ()(target);
 }
 
 } //namespace Trinity
@@ -358,6 +358,50 @@ enum SpellGroupStackRule
 
 typedef std::map<SpellGroup, SpellGroupStackRule> SpellGroupStackMap;
 
+// groups kept inline before SameEffectSpellGroupAmounts spills to the heap
+#define SAME_EFFECT_SPELL_GROUP_INLINE 8
+
+// Highest amount per SPELL_GROUP_STACK_RULE_EXCLUSIVE_SAME_EFFECT group met while summing aura modifiers.
+// Meant to live on the stack of the aggregate queries, only a unit under more
+// distinct groups of one aura type than fit inline allocates
+class SameEffectSpellGroupAmounts
+{
+    public:
+        typedef std::pair<SpellGroup, int32> GroupAmount;
+
+        SameEffectSpellGroupAmounts() : _count(0) { }
+
+        void Add(SpellGroup group, int32 amount)
+        {
+            for (uint32 i = 0; i < size(); ++i)
+            {
+                GroupAmount& entry = At(i);
+                if (entry.first != group)
+                    continue;
+
+                // absolute value because this also counts for the highest negative aura
+                if (abs(entry.second) < abs(amount))
+                    entry.second = amount;
+                return;
+            }
+
+            if (_count < SAME_EFFECT_SPELL_GROUP_INLINE)
+                _inline[_count++] = GroupAmount(group, amount);
+            else
+                _overflow.push_back(GroupAmount(group, amount));
+        }
+
+        uint32 size() const { return _count + uint32(_overflow.size()); }
+        int32 GetAmount(uint32 index) const { return index < _count ? _inline[index].second : _overflow[index - _count].second; }
+
+    private:
+        GroupAmount& At(uint32 index) { return index < _count ? _inline[index] : _overflow[index - _count]; }
+
+        GroupAmount _inline[SAME_EFFECT_SPELL_GROUP_INLINE];
+        uint32 _count;
+        std::vector<GroupAmount> _overflow;
+};
+
 struct SpellThreatEntry
 {
     int32       flatMod;                                    // flat threat-value for this Spell  - default: 0
@@ -652,17 +696,21 @@ class SpellMgr
         void GetSetOfSpellsInSpellGroup(SpellGroup group_id, std::set<uint32>& foundSpells, std::set<SpellGroup>& usedGroups) const;
 
         // Spell Group Stack Rules table
-        bool AddSameEffectStackRuleSpellGroups(SpellInfo const* spellInfo, int32 amount, std::map<SpellGroup, int32>& groups) const;
+        bool AddSameEffectStackRuleSpellGroups(SpellInfo const* spellInfo, int32 amount, SameEffectSpellGroupAmounts& groups) const;
         SpellGroupStackRule CheckSpellGroupStackRules(SpellInfo const* spellInfo1, SpellInfo const* spellInfo2) const;
 
         // Spell proc event table
         SpellProcEventEntry const* GetSpellProcEvent(uint32 spellId) const;
+        uint32 GetSpellProcEventFlags(SpellInfo const* spellInfo) const;
         bool IsSpellProcEventCanTriggeredBy(SpellProcEventEntry const* spellProcEvent, uint32 EventProcFlag, SpellInfo const* procSpell, uint32 procFlags, uint32 procExtra, bool active) const;
 
         // Spell proc table
         SpellProcEntry const* GetSpellProcEntry(uint32 spellId) const;
         bool CanSpellTriggerProcOnEvent(SpellProcEntry const& procEntry, ProcEventInfo& eventInfo) const;
 
+        // bumped whenever spell_proc_event or spell_proc is (re)loaded
+        uint32 GetSpellProcGeneration() const { return mSpellProcGeneration; }
+
         // Spell bonus data table
         SpellBonusEntry const* GetSpellBonusData(uint32 spellId) const;
 
@@ -734,6 +782,7 @@ class SpellMgr
         SpellGroupStackMap         mSpellGroupStack;
         SpellProcEventMap          mSpellProcEventMap;
         SpellProcMap               mSpellProcMap;
+        uint32                     mSpellProcGeneration;
         SpellBonusMap              mSpellBonusMap;
         SpellThreatMap             mSpellThreatMap;
         SpellPetAuraMap            mSpellPetAuraMap;
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2008-2013 TrinityCore <http://www.trinitycore.org/>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TRINITY_SPELLTARGETBUFFER_H
+#define __TRINITY_SPELLTARGETBUFFER_H
+
+#include "Define.h"
+
+#include <ace/TSS_T.h>
+
+#include <vector>
+
+// buffers that grew past this many entries are trimmed when given back, one huge AoE should not pin the memory
+#define SPELL_TARGET_BUFFER_MAX_KEPT_CAPACITY 1024
+
+/**
+ * Scratch vector for the spell target search, borrowed from a pool owned by the
+ * calling (map update) thread and given back when the buffer goes out of scope.
+ *
+ * Target selection nests (a chain search runs an area search, a script hook may
+ * cast another spell), so every scope borrows its own vector. Returned vectors
+ * keep their capacity, so steady AoE casting does not touch the allocator.
+ */
+template<class T>
+class SpellTargetBuffer
+{
+    public:
+        typedef std::vector<T*> Container;
+
+        SpellTargetBuffer() : _pool(Pools), _buffer(_pool->Acquire()) { }
+        ~SpellTargetBuffer() { _pool->Release(_buffer); }
+
+        Container& operator*() { return *_buffer; }
+        Container* operator->() { return _buffer; }
+
+    private:
+        SpellTargetBuffer(SpellTargetBuffer const&);
+        SpellTargetBuffer& operator=(SpellTargetBuffer const&);
+
+        class Pool
+        {
+            public:
+                ~Pool()
+                {
+                    for (typename std::vector<Container*>::const_iterator itr = _free.begin(); itr != _free.end(); ++itr)
+                        delete *itr;
+                }
+
+                Container* Acquire()
+                {
+                    if (_free.empty())
+                        return new Container();
+
+                    Container* buffer = _free.back();
+                    _free.pop_back();
+                    return buffer;
+                }
+
+                void Release(Container* buffer)
+                {
+                    if (buffer->capacity() > SPELL_TARGET_BUFFER_MAX_KEPT_CAPACITY)
+                        Container().swap(*buffer);
+                    else
+                        buffer->clear();
+
+                    _free.push_back(buffer);
+                }
+
+            private:
+                std::vector<Container*> _free;
+        };
+
+        static ACE_TSS<Pool> Pools;
+
+        Pool* _pool;
+        Container* _buffer;
+};
+
+template<class T>
+ACE_TSS<typename SpellTargetBuffer<T>::Pool> SpellTargetBuffer<T>::Pools;
+
+#endif
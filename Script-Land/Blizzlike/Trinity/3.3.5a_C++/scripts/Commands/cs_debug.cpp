@@ -32,6 +32,8 @@ EndScriptData */
 #include "GridNotifiersImpl.h"
 #include "GossipDef.h"
 #include "Language.h"
+#include "MapManager.h"
+#include "UpdateData.h"
 
 #include <fstream>
 
@@ -91,6 +93,10 @@ public:
             { "areatriggers",   SEC_ADMINISTRATOR,  false, &HandleDebugAreaTriggersCommand,    "", NULL },
             { "los",            SEC_MODERATOR,      false, &HandleDebugLoSCommand,             "", NULL },
             { "moveflags",      SEC_ADMINISTRATOR,  false, &HandleDebugMoveflagsCommand,       "", NULL },
+            { "mapcost",        SEC_ADMINISTRATOR,  true,  &HandleDebugMapCostCommand,         "", NULL },
+            { "visibility",     SEC_ADMINISTRATOR,  false, &HandleDebugVisibilityCommand,      "", NULL },
+            { "bgqueue",        SEC_ADMINISTRATOR,  true,  &HandleDebugBgQueueCommand,         "", NULL },
+            { "updatecache",    SEC_ADMINISTRATOR,  true,  &HandleDebugUpdateCacheCommand,     "", NULL },
             { NULL,             SEC_PLAYER,         false, NULL,                               "", NULL }
         };
         static ChatCommand commandTable[] =
@@ -1324,6 +1330,111 @@ public:
         return true;
     }
 
+    struct MapUpdateCostOrderPred
+    {
+        bool operator()(MapUpdateCostStats const& left, MapUpdateCostStats const& right) const { return left.AvgCost > right.AvgCost; }
+    };
+
+    // USAGE: .debug mapcost [#count]
+    // lists the maps with the highest average update cost, as measured by the map update threads
+    static bool HandleDebugMapCostCommand(ChatHandler* handler, char const* args)
+    {
+        uint32 count = *args ? uint32(atoi(args)) : 10;
+        if (!count)
+            count = 10;
+
+        std::vector<MapUpdateCostStats> stats;
+        sMapMgr->GetMapUpdater()->GetCostStats(stats);
+
+        if (stats.empty())
+        {
+            handler->PSendSysMessage("No map update cost recorded (MapUpdate.Threads is 0?)");
+            return true;
+        }
+
+        std::sort(stats.begin(), stats.end(), MapUpdateCostOrderPred());
+
+        for (std::vector<MapUpdateCostStats>::const_iterator itr = stats.begin(); itr != stats.end() && count; ++itr, --count)
+            handler->PSendSysMessage("Map %u instance %u: avg %.1f ms, last %u ms, max %u ms, %u updates",
+                itr->MapId, itr->InstanceId, itr->AvgCost, itr->LastCost, itr->MaxCost, itr->UpdateCount);
+
+        return true;
+    }
+
+    // USAGE: .debug visibility
+    // shows the relocation notify counters of the current map
+    static bool HandleDebugVisibilityCommand(ChatHandler* handler, char const* /*args*/)
+    {
+        Map* map = handler->GetSession()->GetPlayer()->GetMap();
+        MapVisibilityStats stats = map->GetVisibilityStats();
+
+        handler->PSendSysMessage("Map %u instance %u: %u notify ticks, last %u units / %u checks, max %u checks",
+            map->GetId(), map->GetInstanceId(), stats.Ticks, stats.LastUnits, stats.LastChecks, stats.MaxChecks);
+
+        if (stats.Ticks)
+            handler->PSendSysMessage("Average %.1f units / %.1f checks per tick, " UI64FMTD " stale entries",
+                float(stats.TotalUnits) / stats.Ticks, float(stats.TotalChecks) / stats.Ticks, stats.StaleEntries);
+
+        return true;
+    }
+
+    // USAGE: .debug bgqueue
+    // shows the matcher counters and the waiting players of the battleground queues
+    static bool HandleDebugBgQueueCommand(ChatHandler* handler, char const* /*args*/)
+    {
+        bool any = false;
+        for (uint32 i = BATTLEGROUND_QUEUE_NONE + 1; i < MAX_BATTLEGROUND_QUEUE_TYPES; ++i)
+        {
+            BattlegroundQueue& queue = sBattlegroundMgr->GetBattlegroundQueue(BattlegroundQueueTypeId(i));
+            BattlegroundQueueStats const& stats = queue.GetStats();
+            if (!stats.Updates)
+                continue;
+
+            any = true;
+            handler->PSendSysMessage("Queue %u: %u updates, %u searches skipped, %u matches, matcher %.1f us average / %u us max",
+                i, stats.Updates, stats.SkippedSearches, stats.MatchesStarted, float(stats.MatcherTime) / stats.Updates, stats.MaxMatcherTime);
+
+            for (uint32 bracket = 0; bracket < MAX_BATTLEGROUND_BRACKETS; ++bracket)
+            {
+                BattlegroundBracketId bracketId = BattlegroundBracketId(bracket);
+                uint32 waiting[BG_QUEUE_GROUP_TYPES_COUNT];
+                uint32 total = 0;
+                for (uint32 j = 0; j < BG_QUEUE_GROUP_TYPES_COUNT; ++j)
+                    total += waiting[j] = queue.GetWaitingPlayers(bracketId, j);
+
+                if (!total)
+                    continue;
+
+                handler->PSendSysMessage("  bracket %u: alliance %u premade / %u normal, horde %u premade / %u normal waiting, average wait %u / %u ms",
+                    bracket, waiting[BG_QUEUE_PREMADE_ALLIANCE], waiting[BG_QUEUE_NORMAL_ALLIANCE], waiting[BG_QUEUE_PREMADE_HORDE], waiting[BG_QUEUE_NORMAL_HORDE],
+                    queue.GetAverageQueueWaitTime(uint8(TEAM_ALLIANCE), bracketId), queue.GetAverageQueueWaitTime(uint8(TEAM_HORDE), bracketId));
+            }
+        }
+
+        if (!any)
+            handler->PSendSysMessage("No battleground queue update recorded");
+
+        return true;
+    }
+
+    // USAGE: .debug updatecache
+    // shows how often values update blocks were shared between observers
+    static bool HandleDebugUpdateCacheCommand(ChatHandler* handler, char const* /*args*/)
+    {
+        UpdateBlockCacheStats stats = UpdateBlockCache::GetStats();
+        uint64 total = stats.Hits + stats.Misses;
+        if (!total)
+        {
+            handler->PSendSysMessage("No values update block built yet");
+            return true;
+        }
+
+        handler->PSendSysMessage("Values update blocks: " UI64FMTD " shared, " UI64FMTD " built (%.1f%% shared), " UI64FMTD " per target words patched",
+            stats.Hits, stats.Misses, float(stats.Hits) * 100.0f / total, stats.PatchedWords);
+
+        return true;
+    }
+
     static bool HandleWPGPSCommand(ChatHandler* handler, char const* /*args*/)
     {
         Player* player = handler->GetSession()->GetPlayer();